@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "index_trie.hpp"
+
+// type-ahead completions: the top-K names starting with a prefix, best ranked first
+// a name ranks higher the closer its directory is to the searched directory, then the shorter it is,
+// so directories are walked level by level and the walk stops after the first level that fills K results
+
+struct Completion {
+    std::string path;
+    size_t depth;       // directory levels below the searched directory
+    size_t nameLength;  // characters of the name in the trie
+};
+
+struct CompletionResult {
+    std::vector<Completion> completions;
+    bool truncated = false;  // the latency budget ran out before the ranking was final
+    size_t nodesVisited = 0;
+};
+
+// names of one directory trie below "node" in order of length, at most "limit" of them
+inline void trieCompletions(yyjson_val *node, const std::string &dirPath, size_t depth, size_t nameLength, size_t limit,
+                            std::vector<Completion> &out, size_t &nodesVisited) {
+    std::vector<yyjson_val *> level = {node};
+    size_t found = 0;
+    while (!level.empty() && found < limit) {
+        std::vector<yyjson_val *> next;
+        for (yyjson_val *trie : level) {
+            nodesVisited++;
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(trie, idx, max, key, value) {
+                if (isTrieKey(key) && yyjson_is_obj(value)) {
+                    next.push_back(value);
+                } else if (yyjson_is_arr(value) && found < limit) {
+                    // "END": the names that end at this node
+                    yyjson_val *each;
+                    size_t arrIdx, arrMax;
+                    yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                        if (found++ < limit) {
+                            out.push_back({dirPath + yyjson_get_str(each), depth, nameLength});
+                        }
+                    }
+                }
+            }
+        }
+        level.swap(next);
+        nameLength++;
+    }
+}
+
+// the top-K names below the directories "scopes" whose trie key starts with "prefix"
+// returns what was found so far when the budget runs out
+inline CompletionResult autocomplete(const std::vector<DirRef> &scopes, const std::string &prefix, size_t k, std::chrono::microseconds budget) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget;
+    CompletionResult result;
+    std::vector<DirRef> level;
+    for (const auto &scope : scopes) {
+        if (bloomAllows(scope.first, prefix)) {
+            level.push_back(scope);
+        }
+    }
+    size_t depth = 0;
+
+    while (!level.empty() && result.completions.size() < k) {
+        std::vector<DirRef> next;
+        std::vector<Completion> candidates;
+        size_t missing = k - result.completions.size();
+
+        for (size_t i = 0; i < level.size(); i++) {
+            // checking the clock every few directories keeps its cost out of the walk
+            if (i % 32 == 31 && std::chrono::steady_clock::now() > deadline) {
+                result.truncated = true;
+                break;
+            }
+            yyjson_val *dir = level[i].first;
+            const std::string &dirPath = level[i].second;
+            result.nodesVisited++;
+
+            // directories ruled out by their bloom filter are never queued
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, key, value) {
+                if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value) && bloomAllows(value, prefix)) {
+                    next.push_back({value, dirPath + yyjson_get_str(key)});
+                }
+            }
+
+            yyjson_val *match = trieDescend(dir, prefix);
+            if (match && !prefix.empty()) {
+                trieCompletions(match, dirPath, depth, prefix.size(), missing, candidates, result.nodesVisited);
+            }
+        }
+
+        // names of the same level compete on length, a deeper level can't beat any of them
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const Completion &a, const Completion &b) { return a.nameLength < b.nameLength; });
+        for (size_t i = 0; i < candidates.size() && result.completions.size() < k; i++) {
+            result.completions.push_back(std::move(candidates[i]));
+        }
+        if (result.truncated) {
+            break;
+        }
+        level.swap(next);
+        depth++;
+    }
+    return result;
+}
+
+// in-memory completion index for interactive use: every name of the loaded shards flattened into one array
+// sorted by trie key, so the names starting with a prefix are one contiguous range found by binary search,
+// plus a segment tree over the rank to pull the K best of any range without looking at the rest of it
+class CompletionIndex {
+   public:
+    // collect every name below "scope", the documents have to outlive the index
+    void add(yyjson_val *scope, const std::string &scopePath) {
+        std::vector<std::pair<yyjson_val *, uint32_t>> level = {{scope, addDir(scopePath)}};
+        std::string key;
+        for (uint16_t depth = 0; !level.empty(); depth++) {
+            std::vector<std::pair<yyjson_val *, uint32_t>> next;
+            for (const auto &[dir, dirId] : level) {
+                yyjson_val *name, *value;
+                size_t idx, max;
+                yyjson_obj_foreach(dir, idx, max, name, value) {
+                    if (isDirKey(yyjson_get_str(name), yyjson_get_len(name)) && yyjson_is_obj(value)) {
+                        next.push_back({value, addDir(dirs[dirId] + yyjson_get_str(name))});
+                    } else if (isTrieKey(name) && yyjson_is_obj(value)) {
+                        key.assign(yyjson_get_str(name), 1);
+                        addTrie(value, key, dirId, depth);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+    }
+
+    // sort by key and build the rank tree, after this the index is read only
+    void build() {
+        std::sort(entries.begin(), entries.end(), [this](const Entry &a, const Entry &b) {
+            int cmp = keyOf(a).compare(keyOf(b));
+            return cmp != 0 ? cmp < 0 : rankBefore(a, b);
+        });
+        size_t n = entries.size();
+        tree.assign(2 * n, 0);
+        for (size_t i = 0; i < n; i++) {
+            tree[n + i] = static_cast<uint32_t>(i);
+        }
+        for (size_t i = n - 1; i > 0 && n > 1; i--) {
+            tree[i] = better(tree[2 * i], tree[2 * i + 1]);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // the entries of [lo, hi) whose key starts with "prefix", the range of a shorter prefix narrows to the longer one
+    std::pair<size_t, size_t> range(const std::string &prefix, size_t lo, size_t hi) const {
+        auto first = std::lower_bound(entries.begin() + lo, entries.begin() + hi, prefix,
+                                      [this](const Entry &e, const std::string &p) { return keyOf(e).compare(0, p.size(), p) < 0; });
+        auto last = std::upper_bound(first, entries.begin() + hi, prefix,
+                                     [this](const std::string &p, const Entry &e) { return keyOf(e).compare(0, p.size(), p) > 0; });
+        return {static_cast<size_t>(first - entries.begin()), static_cast<size_t>(last - entries.begin())};
+    }
+
+    // the k best ranked entries of [lo, hi): take the best of a range, then split the range around it
+    CompletionResult top(size_t lo, size_t hi, size_t k, std::chrono::microseconds budget) const {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget;
+        CompletionResult result;
+        auto worse = [this](const std::pair<uint32_t, std::pair<size_t, size_t>> &a, const std::pair<uint32_t, std::pair<size_t, size_t>> &b) {
+            return rankBefore(entries[b.first], entries[a.first]);
+        };
+        std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>> heap;
+        if (lo < hi) {
+            heap.push_back({best(lo, hi), {lo, hi}});
+        }
+        while (!heap.empty() && result.completions.size() < k) {
+            if (result.completions.size() % 8 == 7 && std::chrono::steady_clock::now() > deadline) {
+                result.truncated = true;
+                break;
+            }
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            auto [index, bounds] = heap.back();
+            heap.pop_back();
+            result.nodesVisited++;
+
+            const Entry &entry = entries[index];
+            result.completions.push_back({dirs[entry.dir] + entry.name, entry.depth, entry.keyLength});
+            if (bounds.first < index) {
+                heap.push_back({best(bounds.first, index), {bounds.first, index}});
+                std::push_heap(heap.begin(), heap.end(), worse);
+            }
+            if (index + 1 < bounds.second) {
+                heap.push_back({best(index + 1, bounds.second), {index + 1, bounds.second}});
+                std::push_heap(heap.begin(), heap.end(), worse);
+            }
+        }
+        return result;
+    }
+
+    // narrow [lo, hi), where every key starts with the same "position" characters, to the keys continuing with c
+    std::pair<size_t, size_t> narrow(char c, size_t position, size_t lo, size_t hi) const {
+        // keys ending at "position" sort before all longer ones
+        auto charAt = [this, position](const Entry &e) { return e.keyLength > position ? static_cast<int>(static_cast<unsigned char>(keys[e.keyOffset + position])) : -1; };
+        int target = static_cast<unsigned char>(c);
+        auto first = std::lower_bound(entries.begin() + lo, entries.begin() + hi, target,
+                                      [&charAt](const Entry &e, int t) { return charAt(e) < t; });
+        auto last = std::upper_bound(first, entries.begin() + hi, target,
+                                     [&charAt](int t, const Entry &e) { return t < charAt(e); });
+        return {static_cast<size_t>(first - entries.begin()), static_cast<size_t>(last - entries.begin())};
+    }
+
+    CompletionResult complete(const std::string &prefix, size_t k, std::chrono::microseconds budget) const {
+        if (prefix.empty()) {
+            return {};
+        }
+        auto [lo, hi] = range(prefix, 0, entries.size());
+        return top(lo, hi, k, budget);
+    }
+
+   private:
+    struct Entry {
+        uint32_t keyOffset;
+        uint16_t keyLength;
+        uint16_t depth;
+        uint32_t dir;
+        const char *name;  // points into the yyjson document
+    };
+
+    std::string keys;               // trie keys of all entries back to back
+    std::vector<std::string> dirs;  // directory paths, entries refer to them by position
+    std::vector<Entry> entries;
+    std::vector<uint32_t> tree;  // tree[n + i] = i, tree[i] = best of its two children
+
+    uint32_t addDir(const std::string &path) {
+        dirs.push_back(path);
+        return static_cast<uint32_t>(dirs.size() - 1);
+    }
+
+    void addTrie(yyjson_val *node, std::string &key, uint32_t dirId, uint16_t depth) {
+        yyjson_val *name, *value;
+        size_t idx, max;
+        yyjson_obj_foreach(node, idx, max, name, value) {
+            if (isTrieKey(name) && yyjson_is_obj(value)) {
+                key.push_back(yyjson_get_str(name)[0]);
+                addTrie(value, key, dirId, depth);
+                key.pop_back();
+            } else if (yyjson_is_arr(value)) {
+                uint32_t offset = static_cast<uint32_t>(keys.size());
+                keys += key;
+                yyjson_val *each;
+                size_t arrIdx, arrMax;
+                yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                    entries.push_back({offset, static_cast<uint16_t>(key.size()), depth, dirId, yyjson_get_str(each)});
+                }
+            }
+        }
+    }
+
+    std::string_view keyOf(const Entry &e) const { return std::string_view(keys).substr(e.keyOffset, e.keyLength); }
+
+    // same order as the walk: closer to the searched directory first, then shorter names
+    static bool rankBefore(const Entry &a, const Entry &b) {
+        return a.depth != b.depth ? a.depth < b.depth : a.keyLength < b.keyLength;
+    }
+
+    uint32_t better(uint32_t a, uint32_t b) const { return rankBefore(entries[b], entries[a]) ? b : a; }
+
+    // best ranked entry of [lo, hi)
+    uint32_t best(size_t lo, size_t hi) const {
+        size_t n = entries.size();
+        uint32_t result = static_cast<uint32_t>(lo);
+        for (lo += n, hi += n; lo < hi; lo /= 2, hi /= 2) {
+            if (lo & 1) {
+                result = better(result, tree[lo++]);
+            }
+            if (hi & 1) {
+                result = better(result, tree[--hi]);
+            }
+        }
+        return result;
+    }
+};
+
+// one user typing into a search box: keeps the range of every prefix typed so far, so a keystroke narrows
+// the range of the previous prefix by one character and a backspace only drops ranges
+class TypeAheadSession {
+   public:
+    explicit TypeAheadSession(const CompletionIndex &index) : index(index) {}
+
+    CompletionResult type(const std::string &prefix, size_t k, std::chrono::microseconds budget) {
+        // the ranges of the part of the prefix that did not change are still valid
+        size_t keep = 0;
+        while (keep < typed.size() && keep < prefix.size() && typed[keep] == prefix[keep]) {
+            keep++;
+        }
+        reused = keep;
+        typed.resize(keep);
+        ranges.resize(keep);
+
+        for (size_t i = keep; i < prefix.size(); i++) {
+            std::pair<size_t, size_t> previous = i == 0 ? std::make_pair<size_t, size_t>(0, index.size()) : ranges[i - 1];
+            ranges.push_back(index.narrow(prefix[i], i, previous.first, previous.second));
+            typed.push_back(prefix[i]);
+        }
+        if (ranges.empty()) {
+            return {};
+        }
+        return index.top(ranges.back().first, ranges.back().second, k, budget);
+    }
+
+    // characters of the last prefix whose range came from the previous keystrokes
+    size_t reusedCharacters() const { return reused; }
+
+   private:
+    const CompletionIndex &index;
+    std::string typed;
+    std::vector<std::pair<size_t, size_t>> ranges;  // ranges[i] = entries starting with typed[0..i]
+    size_t reused = 0;
+};
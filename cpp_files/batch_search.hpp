@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "index_trie.hpp"
+
+// many prefix searches in one pass over the index: the queries are sorted so the ones sharing a prefix
+// form a contiguous range, and every directory trie is walked once with that range narrowed at each
+// character, so a trie node is visited once no matter how many queries pass through it
+
+struct BatchResult {
+    std::vector<std::vector<std::string>> matches;  // per distinct query key, in the order of BatchSearch::keys
+    size_t nodesVisited = 0;
+};
+
+class BatchSearch {
+   public:
+    explicit BatchSearch(const std::vector<std::string> &queries) {
+        for (const auto &query : queries) {
+            keys.push_back(trieKeyOf(query));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    // distinct query keys, sorted
+    const std::vector<std::string> &queryKeys() const { return keys; }
+
+    size_t indexOf(const std::string &query) const {
+        return std::lower_bound(keys.begin(), keys.end(), trieKeyOf(query)) - keys.begin();
+    }
+
+    BatchResult run(const std::vector<DirRef> &scopes) const {
+        BatchResult result;
+        result.matches.resize(keys.size());
+        if (keys.empty()) {
+            return result;
+        }
+        std::vector<DirRef> level = scopes;
+        while (!level.empty()) {
+            std::vector<DirRef> next;
+            for (const auto &[dir, dirPath] : level) {
+                result.nodesVisited++;
+                yyjson_val *key, *value;
+                size_t idx, max;
+                yyjson_obj_foreach(dir, idx, max, key, value) {
+                    if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value)) {
+                        next.push_back({value, dirPath + yyjson_get_str(key)});
+                    }
+                }
+                walk(dir, dirPath, 0, 0, keys.size(), true, result);
+            }
+            level.swap(next);
+        }
+        return result;
+    }
+
+   private:
+    // keys[lo, hi) all start with the depth characters that lead to "node"
+    void walk(yyjson_val *node, const std::string &dirPath, size_t depth, size_t lo, size_t hi, bool dirRoot, BatchResult &result) const {
+        if (!dirRoot) {
+            result.nodesVisited++;
+        }
+        // sorted keys put the ones that end here first, they match every name below this node
+        size_t complete = lo;
+        while (complete < hi && keys[complete].size() == depth) {
+            complete++;
+        }
+        if (complete > lo && !dirRoot) {
+            std::vector<std::string> names;
+            subtreeNames(node, dirPath, names, result.nodesVisited);
+            for (size_t i = lo; i < complete; i++) {
+                result.matches[i].insert(result.matches[i].end(), names.begin(), names.end());
+            }
+        }
+        lo = complete;
+        if (lo == hi) {
+            return;
+        }
+
+        yyjson_val *key, *value;
+        size_t idx, max;
+        yyjson_obj_foreach(node, idx, max, key, value) {
+            if (!isTrieKey(key) || !yyjson_is_obj(value)) {
+                continue;
+            }
+            // the keys that continue with this character
+            char c = yyjson_get_str(key)[0];
+            size_t first = std::lower_bound(keys.begin() + lo, keys.begin() + hi, c, [depth](const std::string &each, char ch) { return each[depth] < ch; }) - keys.begin();
+            size_t last = std::upper_bound(keys.begin() + first, keys.begin() + hi, c, [depth](char ch, const std::string &each) { return ch < each[depth]; }) - keys.begin();
+            if (first < last) {
+                walk(value, dirPath, depth + 1, first, last, false, result);
+            }
+        }
+    }
+
+    static void subtreeNames(yyjson_val *node, const std::string &dirPath, std::vector<std::string> &out, size_t &nodesVisited) {
+        yyjson_val *key, *value;
+        size_t idx, max;
+        yyjson_obj_foreach(node, idx, max, key, value) {
+            if (isTrieKey(key) && yyjson_is_obj(value)) {
+                nodesVisited++;
+                subtreeNames(value, dirPath, out, nodesVisited);
+            } else if (yyjson_is_arr(value)) {
+                yyjson_val *each;
+                size_t arrIdx, arrMax;
+                yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                    out.push_back(dirPath + yyjson_get_str(each));
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> keys;
+};
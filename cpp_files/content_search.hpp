@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "simd_find.hpp"
+
+// literal search in the contents of a set of files, the files come from an index query so nothing is walked
+// workers take the next file from a shared counter, small files are read into a reused buffer and large ones
+// are mapped, the needle is found with the simd kernel of the name scan and the lines are only counted when
+// there is a hit, the matches of a file are printed together as soon as the file is done
+
+// files below this are read instead of mapped, the mapping costs more than the copy for them
+const size_t GREP_MMAP_MIN = 1 << 16;
+// a NUL in the first bytes makes a file binary, it is reported once instead of line by line
+const size_t GREP_BINARY_PROBE = 8000;
+
+struct GrepStats {
+    size_t files = 0;
+    size_t matchingFiles = 0;
+    size_t lines = 0;  // matching lines
+    uint64_t bytes = 0;
+    unsigned threads = 1;
+};
+
+// appends "path:line:text" for every line of data[0, length) containing needle, returns the number of lines
+inline size_t grepBuffer(const char *data, size_t length, const std::string &path, const std::string &needle, std::string &out) {
+    if (memchr(data, '\0', std::min(length, GREP_BINARY_PROBE))) {
+        if (!simdFind(data, length, needle)) {
+            return 0;
+        }
+        out += "Binary file " + path + " matches\n";
+        return 1;
+    }
+    size_t lines = 0;
+    size_t lineNumber = 1;
+    const char *counted = data;
+    const char *end = data + length;
+    const char *at = data;
+    while (const char *hit = simdFind(at, end - at, needle)) {
+        const char *lineStart = hit;
+        while (lineStart > at && lineStart[-1] != '\n') {
+            lineStart--;
+        }
+        const char *lineEnd = static_cast<const char *>(memchr(hit, '\n', end - hit));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        lineNumber += std::count(counted, lineStart, '\n');
+        counted = lineStart;
+        size_t textLength = lineEnd - lineStart;
+        if (textLength > 0 && lineStart[textLength - 1] == '\r') {
+            textLength--;
+        }
+        out += path;
+        out += ':';
+        out += std::to_string(lineNumber);
+        out += ':';
+        out.append(lineStart, textLength);
+        out += '\n';
+        lines++;
+        // one report per line, go on after it
+        if (lineEnd == end) {
+            break;
+        }
+        at = lineEnd + 1;
+    }
+    return lines;
+}
+
+// the matching lines of one file appended to out, false if it can't be read
+inline bool grepFile(const std::string &path, const std::string &needle, std::vector<char> &buffer, std::string &out, size_t &lines, uint64_t &bytes) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    // the first block tells whether the file is small enough to be done with the read
+    size_t length = fread(buffer.data(), 1, buffer.size(), fp);
+    bool whole = length < buffer.size();
+    fclose(fp);
+    if (whole) {
+        bytes += length;
+        lines += grepBuffer(buffer.data(), length, path, needle, out);
+        return true;
+    }
+    MappedFile mapped(path);
+    if (!mapped.valid()) {
+        return false;
+    }
+    bytes += mapped.size();
+    lines += grepBuffer(mapped.data(), mapped.size(), path, needle, out);
+    return true;
+}
+
+// greps every file on threadCount workers and writes the matches to out, the lines of a file stay together
+inline GrepStats grepFiles(const std::vector<std::string> &paths, const std::string &needle, unsigned threadCount, std::ostream &out) {
+    GrepStats stats;
+    stats.threads = std::max(1u, std::min<unsigned>(threadCount, static_cast<unsigned>(paths.size())));
+    std::atomic<size_t> next(0);
+    std::mutex printMutex;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < stats.threads; t++) {
+        threads.emplace_back([&]() {
+            std::vector<char> buffer(GREP_MMAP_MIN);
+            std::string found;
+            size_t files = 0, matchingFiles = 0, lines = 0;
+            uint64_t bytes = 0;
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                size_t before = lines;
+                found.clear();
+                if (!grepFile(paths[i], needle, buffer, found, lines, bytes)) {
+                    continue;
+                }
+                files++;
+                if (lines > before) {
+                    matchingFiles++;
+                    std::unique_lock<std::mutex> guard(printMutex);
+                    out << found;
+                    out.flush();
+                }
+            }
+            std::unique_lock<std::mutex> guard(printMutex);
+            stats.files += files;
+            stats.matchingFiles += matchingFiles;
+            stats.lines += lines;
+            stats.bytes += bytes;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return stats;
+}
+
+// ---- baseline for --bench: std::ifstream, std::getline and std::string::find, one file after the other ----
+inline size_t naiveGrep(const std::vector<std::string> &paths, const std::string &needle, std::string &out) {
+    size_t lines = 0;
+    for (const auto &path : paths) {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            if (line.find(needle) != std::string::npos) {
+                out += path + ":" + std::to_string(lineNumber) + ":" + line + "\n";
+                lines++;
+            }
+        }
+    }
+    return lines;
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "index_format.hpp"
+
+// the directory tree of a shard with identical subtrees stored once, next to the file index as .dag
+// copies of the same tree (node_modules, vendored sdks, build outputs) are found bottom up: a directory is
+// described by its sorted names and its sorted (child name, child node) pairs, and directories with the same
+// description are the same node, so two subtrees share a node exactly when they hold the same names all the way down
+// a query matches the names of every node once and then walks the concrete paths, skipping the nodes with no
+// match below them, so every copy is still reported under its own path
+// file layout: magic, node count, root node, string count, string bytes, name refs, child refs, then the
+// name ref start and child ref start of every node (u32, nodes + 1 each), the name refs (u32 string),
+// the child refs (u32 string, u32 node), the string offsets (u32, strings + 1) and the strings
+
+const char DAG_MAGIC[8] = {'F', 'F', 'D', 'A', 'G', 'T', 'R', '1'};
+
+struct DagNode {
+    std::vector<uint32_t> names;                         // strings
+    std::vector<std::pair<uint32_t, uint32_t>> children;  // (string, node)
+};
+
+// the tree of the name blob with identical subtrees merged, nodes[root] is the blob's first directory
+struct DagBuilder {
+    std::vector<DagNode> nodes;
+    std::vector<std::string> strings;
+    uint32_t root = 0;
+    size_t concreteDirs = 0;
+
+    explicit DagBuilder(const NameBlob &blob) {
+        concreteDirs = blob.dirCount();
+        if (concreteDirs == 0) {
+            nodes.emplace_back();
+            return;
+        }
+        // the blob lists the directories depth first, the parent of one is the nearest earlier directory it extends
+        std::vector<uint32_t> parent(blob.dirCount(), UINT32_MAX);
+        std::vector<uint32_t> open;
+        std::vector<std::string> paths(blob.dirCount());
+        for (uint32_t dir = 0; dir < blob.dirCount(); dir++) {
+            paths[dir] = blob.dirPath(dir);
+            while (!open.empty() && paths[dir].compare(0, paths[open.back()].size(), paths[open.back()]) != 0) {
+                open.pop_back();
+            }
+            if (!open.empty()) {
+                parent[dir] = open.back();
+            }
+            open.push_back(dir);
+        }
+        std::vector<std::vector<uint32_t>> names(blob.dirCount());
+        for (const auto &entry : blob.entries) {
+            names[entry.dir].push_back(intern(blob.names.substr(entry.offset, entry.length)));
+        }
+
+        // children come after their parent, so going backwards every child has its node before the parent needs it
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> children(blob.dirCount());
+        std::unordered_map<std::string, uint32_t> known;
+        std::vector<uint32_t> nodeOf(blob.dirCount());
+        for (uint32_t dir = static_cast<uint32_t>(blob.dirCount()); dir-- > 0;) {
+            DagNode node;
+            node.names = std::move(names[dir]);
+            node.children = std::move(children[dir]);
+            std::sort(node.names.begin(), node.names.end(), [&](uint32_t a, uint32_t b) { return strings[a] < strings[b]; });
+            std::sort(node.children.begin(), node.children.end(), [&](const auto &a, const auto &b) { return strings[a.first] < strings[b.first]; });
+            // strings and nodes are already shared, so their ids describe the subtree exactly
+            std::string description;
+            for (uint32_t name : node.names) {
+                description.append(reinterpret_cast<const char *>(&name), sizeof(name));
+            }
+            description += '\0';
+            for (const auto &[name, child] : node.children) {
+                description.append(reinterpret_cast<const char *>(&name), sizeof(name));
+                description.append(reinterpret_cast<const char *>(&child), sizeof(child));
+            }
+            auto found = known.find(description);
+            if (found == known.end()) {
+                found = known.emplace(std::move(description), static_cast<uint32_t>(nodes.size())).first;
+                nodes.push_back(std::move(node));
+            }
+            nodeOf[dir] = found->second;
+            if (parent[dir] != UINT32_MAX) {
+                children[parent[dir]].push_back({intern(paths[dir].substr(paths[parent[dir]].size())), found->second});
+            }
+        }
+        root = nodeOf[0];
+    }
+
+    uint32_t intern(const std::string &text) {
+        auto found = stringIds.find(text);
+        if (found != stringIds.end()) {
+            return found->second;
+        }
+        strings.push_back(text);
+        return stringIds[text] = static_cast<uint32_t>(strings.size() - 1);
+    }
+
+    bool write(const std::string &file) const {
+        std::vector<uint32_t> nameStart = {0}, childStart = {0}, nameRefs, childRefs, stringOffsets = {0};
+        for (const auto &node : nodes) {
+            nameRefs.insert(nameRefs.end(), node.names.begin(), node.names.end());
+            for (const auto &[name, child] : node.children) {
+                childRefs.push_back(name);
+                childRefs.push_back(child);
+            }
+            nameStart.push_back(static_cast<uint32_t>(nameRefs.size()));
+            childStart.push_back(static_cast<uint32_t>(childRefs.size() / 2));
+        }
+        std::string text;
+        for (const auto &each : strings) {
+            text += each;
+            stringOffsets.push_back(static_cast<uint32_t>(text.size()));
+        }
+
+        FILE *fp = fopen(file.c_str(), "wb");
+        if (!fp) {
+            return false;
+        }
+        uint32_t header[6] = {static_cast<uint32_t>(nodes.size()), root, static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size()),
+                              static_cast<uint32_t>(nameRefs.size()), static_cast<uint32_t>(childRefs.size() / 2)};
+        auto put = [fp](const std::vector<uint32_t> &values) { return fwrite(values.data(), sizeof(uint32_t), values.size(), fp) == values.size(); };
+        bool ok = fwrite(DAG_MAGIC, 1, sizeof(DAG_MAGIC), fp) == sizeof(DAG_MAGIC) && fwrite(header, sizeof(header), 1, fp) == 1 &&
+                  put(nameStart) && put(childStart) && put(nameRefs) && put(childRefs) && put(stringOffsets) &&
+                  fwrite(text.data(), 1, text.size(), fp) == text.size();
+        return fclose(fp) == 0 && ok;
+    }
+
+   private:
+    std::unordered_map<std::string, uint32_t> stringIds;
+};
+
+// read-only view of a .dag file, usually a memory mapping
+class DagIndex {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint32_t header[6];
+        if (fileSize < sizeof(DAG_MAGIC) + sizeof(header) || memcmp(file, DAG_MAGIC, sizeof(DAG_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(DAG_MAGIC), sizeof(header));
+        nodeCount = header[0];
+        root = header[1];
+        stringCount = header[2];
+        const uint32_t *at = reinterpret_cast<const uint32_t *>(file + sizeof(DAG_MAGIC) + sizeof(header));
+        nameStart = at;
+        childStart = nameStart + nodeCount + 1;
+        nameRefs = childStart + nodeCount + 1;
+        childRefs = nameRefs + header[4];
+        stringOffsets = childRefs + 2 * header[5];
+        text = reinterpret_cast<const char *>(stringOffsets + stringCount + 1);
+        return text + header[3] == file + fileSize && root < nodeCount;
+    }
+
+    size_t nodes() const { return nodeCount; }
+
+    // concrete directories the nodes stand for, every path from the root counted once
+    uint64_t concreteDirs() const {
+        std::vector<uint64_t> below(nodeCount, 0);
+        std::vector<char> done(nodeCount, 0);
+        return countBelow(root, below, done);
+    }
+
+    // calls fn with the full path of every name below searchDir for which keep(name) is true, every copy of a
+    // shared subtree under its own path; keep is called once per distinct node, not once per copy
+    template <typename Keep, typename Fn>
+    void forEachMatch(const std::string &searchDir, Keep keep, Fn fn) const {
+        // 0 unknown, 1 no match below, 2 a match below
+        std::vector<char> state(nodeCount, 0);
+        std::vector<std::vector<uint32_t>> matches(nodeCount);
+        std::string path;
+        walk(root, path, searchDir, keep, fn, state, matches);
+    }
+
+   private:
+    std::string stringAt(uint32_t id) const { return std::string(text + stringOffsets[id], stringOffsets[id + 1] - stringOffsets[id]); }
+
+    template <typename Keep>
+    bool matchBelow(uint32_t node, Keep &keep, std::vector<char> &state, std::vector<std::vector<uint32_t>> &matches) const {
+        if (state[node] == 0) {
+            bool any = false;
+            for (uint32_t ref = nameStart[node]; ref < nameStart[node + 1]; ref++) {
+                if (keep(stringAt(nameRefs[ref]))) {
+                    matches[node].push_back(nameRefs[ref]);
+                    any = true;
+                }
+            }
+            for (uint32_t ref = childStart[node]; ref < childStart[node + 1]; ref++) {
+                any |= matchBelow(childRefs[2 * ref + 1], keep, state, matches);
+            }
+            state[node] = any ? 2 : 1;
+        }
+        return state[node] == 2;
+    }
+
+    template <typename Keep, typename Fn>
+    void walk(uint32_t node, std::string &path, const std::string &searchDir, Keep &keep, Fn &fn, std::vector<char> &state,
+              std::vector<std::vector<uint32_t>> &matches) const {
+        bool inScope = path.size() >= searchDir.size();
+        if (inScope && !matchBelow(node, keep, state, matches)) {
+            return;
+        }
+        if (inScope) {
+            for (uint32_t name : matches[node]) {
+                fn(path + stringAt(name));
+            }
+        }
+        for (uint32_t ref = childStart[node]; ref < childStart[node + 1]; ref++) {
+            size_t length = path.size();
+            path += stringAt(childRefs[2 * ref]);
+            // above searchDir only the directories on the way to it are entered
+            size_t common = std::min(path.size(), searchDir.size());
+            if (path.compare(0, common, searchDir, 0, common) == 0) {
+                walk(childRefs[2 * ref + 1], path, searchDir, keep, fn, state, matches);
+            }
+            path.resize(length);
+        }
+    }
+
+    uint64_t countBelow(uint32_t node, std::vector<uint64_t> &below, std::vector<char> &done) const {
+        if (!done[node]) {
+            below[node] = 1;
+            for (uint32_t ref = childStart[node]; ref < childStart[node + 1]; ref++) {
+                below[node] += countBelow(childRefs[2 * ref + 1], below, done);
+            }
+            done[node] = 1;
+        }
+        return below[node];
+    }
+
+    uint32_t nodeCount = 0;
+    uint32_t root = 0;
+    uint32_t stringCount = 0;
+    const uint32_t *nameStart = nullptr;
+    const uint32_t *childStart = nullptr;
+    const uint32_t *nameRefs = nullptr;
+    const uint32_t *childRefs = nullptr;
+    const uint32_t *stringOffsets = nullptr;
+    const char *text = nullptr;
+};
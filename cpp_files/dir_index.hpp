@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "path_dictionary.hpp"
+#include "simd_find.hpp"
+
+// the directories of a shard on their own, next to the file index as .dirs
+// a directory search scans the lowercase names of the directories only and never reads the names of the files,
+// which are most of the index; the paths are a front coded path dictionary, sorted, so the directories below
+// the searched one are a range of ids found with two lookups instead of a comparison per hit
+// file layout: magic, directory count, name bytes, dictionary bytes, then the name offsets (u32, count + 1),
+// the lowercase names ("\n" after each, in path order) and the path dictionary of the full paths
+
+const char DIR_INDEX_MAGIC[8] = {'F', 'F', 'D', 'I', 'R', 'S', '0', '1'};
+
+// paths must be sorted and unique
+inline bool writeDirIndex(const std::string &file, const std::vector<std::string> &paths) {
+    std::vector<uint32_t> offsets = {0};
+    std::string names;
+    for (const auto &path : paths) {
+        size_t slash = path.find_last_of('/', path.size() - 2);
+        for (size_t i = slash == std::string::npos ? 0 : slash + 1; i < path.size(); i++) {
+            names += static_cast<char>(tolower(static_cast<unsigned char>(path[i])));
+        }
+        names += '\n';
+        offsets.push_back(static_cast<uint32_t>(names.size()));
+    }
+    std::string dictionary = encodePathDictionary(paths);
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t header[3] = {paths.size(), names.size(), dictionary.size()};
+    // the dictionary reads u64 offsets in place, it starts 8-byte aligned
+    static const char padding[8] = {0};
+    size_t pad = (8 - (offsets.size() * sizeof(uint32_t) + names.size()) % 8) % 8;
+    bool ok = fwrite(DIR_INDEX_MAGIC, 1, sizeof(DIR_INDEX_MAGIC), fp) == sizeof(DIR_INDEX_MAGIC) &&
+              fwrite(header, sizeof(header), 1, fp) == 1 && fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), fp) == offsets.size() &&
+              fwrite(names.data(), 1, names.size(), fp) == names.size() && fwrite(padding, 1, pad, fp) == pad &&
+              fwrite(dictionary.data(), 1, dictionary.size(), fp) == dictionary.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// read-only view of a .dirs file, usually a memory mapping
+class DirIndex {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint64_t header[3];
+        if (fileSize < sizeof(DIR_INDEX_MAGIC) + sizeof(header) || memcmp(file, DIR_INDEX_MAGIC, sizeof(DIR_INDEX_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(DIR_INDEX_MAGIC), sizeof(header));
+        count = header[0];
+        offsets = reinterpret_cast<const uint32_t *>(file + sizeof(DIR_INDEX_MAGIC) + sizeof(header));
+        names = reinterpret_cast<const char *>(offsets + count + 1);
+        size_t namesEnd = sizeof(DIR_INDEX_MAGIC) + sizeof(header) + (count + 1) * sizeof(uint32_t) + header[1];
+        size_t dictionaryAt = namesEnd + (8 - namesEnd % 8) % 8;
+        return dictionaryAt + header[2] == fileSize && paths.open(file + dictionaryAt, header[2]) && paths.size() == count;
+    }
+
+    size_t size() const { return count; }
+    std::string path(size_t id) const { return paths.at(id); }
+
+    // ids of the directories below searchDir whose lowercase name contains query, in path order
+    std::vector<uint32_t> search(const std::string &searchDir, const std::string &query) const {
+        // every path starting with "C:/Users/" sorts before "C:/Users0"
+        std::string end = searchDir;
+        if (!end.empty()) {
+            end.back()++;
+        }
+        size_t first = searchDir.empty() ? 0 : paths.lowerBound(searchDir);
+        size_t last = searchDir.empty() ? count : paths.lowerBound(end);
+        std::vector<uint32_t> found;
+        if (first >= last) {
+            return found;
+        }
+        const char *at = names + offsets[first];
+        const char *stop = names + offsets[last];
+        size_t id = first;
+        while (const char *hit = simdFind(at, stop - at, query)) {
+            uint32_t offset = static_cast<uint32_t>(hit - names);
+            id = std::upper_bound(offsets + id, offsets + last + 1, offset) - offsets - 1;
+            found.push_back(static_cast<uint32_t>(id));
+            if (++id >= last) {
+                break;
+            }
+            at = names + offsets[id];
+        }
+        return found;
+    }
+
+   private:
+    uint64_t count = 0;
+    const uint32_t *offsets = nullptr;
+    const char *names = nullptr;
+    PathDictionary paths;
+};
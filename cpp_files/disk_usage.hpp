@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// recursive size, file count and directory count of every crawled directory, so "du" and the largest
+// directories below a path are answered from the index instead of walking the tree again
+// the crawler sums the direct contents of each directory, the sums are rolled up into the parents once the
+// crawl is done and written per shard next to the file index as .usage
+// a shard only rolls up its own directories, the crawl root above the shards is completed by the searcher
+// from the shard tops, so re-indexing one shard never leaves a stale total in another
+
+struct DirUsage {
+    uint64_t bytes = 0;
+    uint64_t files = 0;
+    uint64_t dirs = 0;
+
+    void add(const DirUsage &other) {
+        bytes += other.bytes;
+        files += other.files;
+        dirs += other.dirs;
+    }
+};
+
+typedef std::pair<std::string, DirUsage> UsageRow;
+
+// "C:/Users/alice/" --> "C:/Users/", "" for a root
+inline std::string parentKey(const std::string &key) {
+    if (key.size() < 2) {
+        return "";
+    }
+    size_t slash = key.find_last_of('/', key.size() - 2);
+    return slash == std::string::npos ? "" : key.substr(0, slash + 1);
+}
+
+// turns the direct sums into recursive ones, a directory in "boundaries" is not added to its parent
+// longer keys go first so a directory is complete before it is added to its parent
+inline void rollUp(std::unordered_map<std::string, DirUsage> &usage, const std::unordered_set<std::string> &boundaries) {
+    std::vector<std::unordered_map<std::string, DirUsage>::iterator> order;
+    order.reserve(usage.size());
+    for (auto it = usage.begin(); it != usage.end(); ++it) {
+        order.push_back(it);
+    }
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a->first.size() > b->first.size(); });
+    for (const auto &it : order) {
+        if (boundaries.count(it->first)) {
+            continue;
+        }
+        auto parent = usage.find(parentKey(it->first));
+        if (parent != usage.end()) {
+            parent->second.add(it->second);
+        }
+    }
+}
+
+// the n directories below "under" with the most bytes, largest first
+inline std::vector<UsageRow> largestDirectories(const std::unordered_map<std::string, DirUsage> &usage, const std::string &under, size_t n) {
+    std::vector<UsageRow> rows;
+    for (const auto &[key, each] : usage) {
+        if (key.size() > under.size() && key.compare(0, under.size(), under) == 0) {
+            rows.push_back({key, each});
+        }
+    }
+    auto larger = [](const UsageRow &a, const UsageRow &b) { return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first; };
+    n = std::min(n, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + n, rows.end(), larger);
+    rows.resize(n);
+    return rows;
+}
+
+// ---- usage table ----
+// file layout: magic, row count, path bytes, path offsets (count + 1), paths, then bytes, files and dirs
+// as one u64 array each
+const char USAGE_MAGIC[8] = {'F', 'F', 'U', 'S', 'A', 'G', 'E', '1'};
+
+inline bool writeUsageTable(const std::string &file, const std::vector<UsageRow> &rows) {
+    std::vector<uint64_t> offsets = {0}, bytes, files, dirs;
+    std::string paths;
+    for (const auto &[key, each] : rows) {
+        paths += key;
+        offsets.push_back(paths.size());
+        bytes.push_back(each.bytes);
+        files.push_back(each.files);
+        dirs.push_back(each.dirs);
+    }
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t header[2] = {rows.size(), paths.size()};
+    bool ok = fwrite(USAGE_MAGIC, 1, sizeof(USAGE_MAGIC), fp) == sizeof(USAGE_MAGIC) &&
+              fwrite(header, sizeof(header), 1, fp) == 1 &&
+              fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp) == offsets.size() &&
+              fwrite(paths.data(), 1, paths.size(), fp) == paths.size() &&
+              fwrite(bytes.data(), sizeof(uint64_t), rows.size(), fp) == rows.size() &&
+              fwrite(files.data(), sizeof(uint64_t), rows.size(), fp) == rows.size() &&
+              fwrite(dirs.data(), sizeof(uint64_t), rows.size(), fp) == rows.size();
+    return fclose(fp) == 0 && ok;
+}
+
+inline bool readUsageTable(const std::string &file, std::vector<UsageRow> &rows) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    char magic[sizeof(USAGE_MAGIC)];
+    uint64_t header[2];
+    bool ok = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, USAGE_MAGIC, sizeof(magic)) == 0 &&
+              fread(header, sizeof(header), 1, fp) == 1;
+    if (ok) {
+        uint64_t count = header[0];
+        std::vector<uint64_t> offsets(count + 1), bytes(count), files(count), dirs(count);
+        std::string paths(header[1], '\0');
+        ok = fread(offsets.data(), sizeof(uint64_t), offsets.size(), fp) == offsets.size() &&
+             fread(&paths[0], 1, paths.size(), fp) == paths.size() &&
+             fread(bytes.data(), sizeof(uint64_t), count, fp) == count &&
+             fread(files.data(), sizeof(uint64_t), count, fp) == count &&
+             fread(dirs.data(), sizeof(uint64_t), count, fp) == count;
+        for (uint64_t i = 0; ok && i < count; i++) {
+            rows.push_back({paths.substr(offsets[i], offsets[i + 1] - offsets[i]), {bytes[i], files[i], dirs[i]}});
+        }
+    }
+    fclose(fp);
+    return ok;
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "index_format.hpp"
+
+// duplicate files from the index: the sizes in the metadata columns split the files into groups first,
+// only files sharing a size have their first and last few KB hashed, and only files still sharing that hash
+// are hashed whole, so most files are never opened and most of the rest only have two blocks read
+// the hashing is spread over worker threads, each taking the next file from a shared counter
+// hard links of one file share their size too, so the files sharing a size have their file id read first and a
+// file reached through several links is hashed and reported once; the index does not store the ids, reading them
+// costs a call per file, which is only paid for the files that share a size
+
+// bytes hashed at each end of a file in the first pass, a file up to twice this is hashed whole by it
+const size_t DUP_EDGE_BYTES = 4096;
+const size_t DUP_READ_BUFFER = 1 << 20;
+
+// xxh64, a fast non-cryptographic 64-bit hash, fed in pieces
+class Hash64 {
+   public:
+    explicit Hash64(uint64_t seed = 0) : seed(seed) {
+        lanes[0] = seed + P1 + P2;
+        lanes[1] = seed + P2;
+        lanes[2] = seed;
+        lanes[3] = seed - P1;
+    }
+
+    void update(const void *data, size_t length) {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        const unsigned char *end = p + length;
+        total += length;
+        if (buffered + length < sizeof(buffer)) {
+            memcpy(buffer + buffered, p, length);
+            buffered += length;
+            return;
+        }
+        if (buffered > 0) {
+            size_t fill = sizeof(buffer) - buffered;
+            memcpy(buffer + buffered, p, fill);
+            stripe(buffer);
+            p += fill;
+            buffered = 0;
+        }
+        for (; p + sizeof(buffer) <= end; p += sizeof(buffer)) {
+            stripe(p);
+        }
+        buffered = end - p;
+        memcpy(buffer, p, buffered);
+    }
+
+    uint64_t digest() const {
+        uint64_t hash;
+        if (total >= sizeof(buffer)) {
+            hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+            for (uint64_t lane : lanes) {
+                hash = (hash ^ round(0, lane)) * P1 + P4;
+            }
+        } else {
+            hash = seed + P5;
+        }
+        hash += total;
+
+        const unsigned char *p = buffer;
+        const unsigned char *end = buffer + buffered;
+        for (; p + 8 <= end; p += 8) {
+            hash ^= round(0, read64(p));
+            hash = rotl(hash, 27) * P1 + P4;
+        }
+        if (p + 4 <= end) {
+            uint32_t word;
+            memcpy(&word, p, sizeof(word));
+            hash ^= word * P1;
+            hash = rotl(hash, 23) * P2 + P3;
+            p += 4;
+        }
+        for (; p < end; p++) {
+            hash ^= *p * P5;
+            hash = rotl(hash, 11) * P1;
+        }
+        hash ^= hash >> 33;
+        hash *= P2;
+        hash ^= hash >> 29;
+        hash *= P3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+   private:
+    static const uint64_t P1 = 11400714785074694791ull;
+    static const uint64_t P2 = 14029467366897019727ull;
+    static const uint64_t P3 = 1609587929392839161ull;
+    static const uint64_t P4 = 9650029242287828579ull;
+    static const uint64_t P5 = 2870177450012600261ull;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t read64(const unsigned char *p) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        return word;
+    }
+    static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; }
+
+    void stripe(const unsigned char *p) {
+        for (int i = 0; i < 4; i++) {
+            lanes[i] = round(lanes[i], read64(p + 8 * i));
+        }
+    }
+
+    uint64_t seed;
+    uint64_t lanes[4];
+    uint64_t total = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+};
+
+struct DupFile {
+    std::string path;
+    uint64_t size;
+};
+
+struct DupStats {
+    uint64_t totalBytes = 0;  // size of every file looked at
+    uint64_t bytesRead = 0;
+    size_t sizeCandidates = 0;  // files sharing their size with another
+    size_t hardLinks = 0;       // of those, extra links to a file already seen
+    size_t edgeCandidates = 0;  // files sharing size and edge hash with another, hashed whole
+    double hashSeconds = 0;
+    unsigned threads = 1;
+};
+
+// volume and file index of a file, the same for every hard link to it
+struct FileId {
+    uint64_t volume = 0;
+    uint64_t index = 0;
+    bool operator<(const FileId &other) const { return volume != other.volume ? volume < other.volume : index < other.index; }
+};
+
+inline bool readFileId(const DupFile &file, FileId &id, uint64_t &) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file.path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ok = GetFileInformationByHandle(handle, &info) != 0;
+    if (ok) {
+        id.volume = info.dwVolumeSerialNumber;
+        id.index = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    }
+    CloseHandle(handle);
+    return ok;
+#else
+    struct stat info;
+    if (stat(file.path.c_str(), &info) != 0) {
+        return false;
+    }
+    id.volume = static_cast<uint64_t>(info.st_dev);
+    id.index = static_cast<uint64_t>(info.st_ino);
+    return true;
+#endif
+}
+
+// hash of the first and last DUP_EDGE_BYTES of a file, of the whole file when it is not larger than both
+inline bool hashEdges(const DupFile &file, uint64_t &hash, uint64_t &bytesRead) {
+    FILE *fp = fopen(file.path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    std::vector<unsigned char> block(2 * DUP_EDGE_BYTES);
+    size_t wanted = file.size <= block.size() ? static_cast<size_t>(file.size) : DUP_EDGE_BYTES;
+    size_t got = fread(block.data(), 1, wanted, fp);
+    if (got == wanted && wanted < file.size) {
+        got += seekFile(fp, file.size - DUP_EDGE_BYTES) == 0 ? fread(block.data() + got, 1, DUP_EDGE_BYTES, fp) : 0;
+        wanted += DUP_EDGE_BYTES;
+    }
+    fclose(fp);
+    bytesRead += got;
+    if (got != wanted) {
+        return false;
+    }
+    Hash64 hasher;
+    hasher.update(block.data(), got);
+    hash = hasher.digest();
+    return true;
+}
+
+inline bool hashWhole(const DupFile &file, uint64_t &hash, uint64_t &bytesRead) {
+    FILE *fp = fopen(file.path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    std::vector<unsigned char> block(DUP_READ_BUFFER);
+    Hash64 hasher;
+    uint64_t length = 0;
+    size_t got;
+    while ((got = fread(block.data(), 1, block.size(), fp)) > 0) {
+        hasher.update(block.data(), got);
+        length += got;
+    }
+    fclose(fp);
+    bytesRead += length;
+    hash = hasher.digest();
+    // a file that changed size since it was indexed is left out
+    return length == file.size;
+}
+
+// hashes files[which[i]] into hashes[i] on threadCount workers, ok[i] is false when a file could not be read
+template <typename Hash, typename HashFn>
+inline void hashInParallel(const std::vector<DupFile> &files, const std::vector<size_t> &which, HashFn hashFn, unsigned threadCount,
+                           std::vector<Hash> &hashes, std::vector<char> &ok, uint64_t &bytesRead) {
+    hashes.assign(which.size(), Hash());
+    ok.assign(which.size(), 0);
+    std::atomic<size_t> next(0);
+    std::atomic<uint64_t> read(0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < std::max(1u, threadCount); t++) {
+        threads.emplace_back([&]() {
+            uint64_t local = 0;
+            for (size_t i = next++; i < which.size(); i = next++) {
+                ok[i] = hashFn(files[which[i]], hashes[i], local);
+            }
+            read += local;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    bytesRead += read;
+}
+
+// groups of identical files, each group sorted by path, the groups by wasted bytes (size * extra copies)
+inline std::vector<std::vector<size_t>> findDuplicates(const std::vector<DupFile> &files, unsigned threadCount, DupStats &stats) {
+    stats.threads = std::max(1u, threadCount);
+    // 1. by size, from the index
+    std::map<uint64_t, std::vector<size_t>> bySize;
+    for (size_t i = 0; i < files.size(); i++) {
+        stats.totalBytes += files[i].size;
+        if (files[i].size > 0) {
+            bySize[files[i].size].push_back(i);
+        }
+    }
+    std::vector<size_t> shared;
+    for (const auto &[size, group] : bySize) {
+        if (group.size() > 1) {
+            shared.insert(shared.end(), group.begin(), group.end());
+        }
+    }
+    stats.sizeCandidates = shared.size();
+
+    auto begin = std::chrono::steady_clock::now();
+    // 2. one path per file, the other hard links to it are no copies; a file whose id can't be read stays in
+    std::vector<FileId> ids;
+    std::vector<char> ok;
+    uint64_t unused = 0;
+    hashInParallel(files, shared, readFileId, stats.threads, ids, ok, unused);
+    std::set<FileId> seen;
+    std::map<uint64_t, std::vector<size_t>> distinct;
+    for (size_t i = 0; i < shared.size(); i++) {
+        if (ok[i] && !seen.insert(ids[i]).second) {
+            stats.hardLinks++;
+            continue;
+        }
+        distinct[files[shared[i]].size].push_back(shared[i]);
+    }
+    std::vector<size_t> candidates;
+    for (const auto &[size, group] : distinct) {
+        if (group.size() > 1) {
+            candidates.insert(candidates.end(), group.begin(), group.end());
+        }
+    }
+
+    // 3. by size and the hash of both ends
+    std::vector<uint64_t> hashes;
+    hashInParallel(files, candidates, hashEdges, stats.threads, hashes, ok, stats.bytesRead);
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<size_t>> byEdges;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (ok[i]) {
+            byEdges[{files[candidates[i]].size, hashes[i]}].push_back(candidates[i]);
+        }
+    }
+
+    // 4. by size and the hash of the whole file, for the files the edges did not cover
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> whole;
+    for (const auto &[key, group] : byEdges) {
+        if (group.size() < 2) {
+            continue;
+        }
+        if (key.first <= 2 * DUP_EDGE_BYTES) {
+            groups.push_back(group);
+        } else {
+            whole.insert(whole.end(), group.begin(), group.end());
+        }
+    }
+    stats.edgeCandidates = whole.size();
+    hashInParallel(files, whole, hashWhole, stats.threads, hashes, ok, stats.bytesRead);
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<size_t>> byContent;
+    for (size_t i = 0; i < whole.size(); i++) {
+        if (ok[i]) {
+            byContent[{files[whole[i]].size, hashes[i]}].push_back(whole[i]);
+        }
+    }
+    for (const auto &[key, group] : byContent) {
+        if (group.size() > 1) {
+            groups.push_back(group);
+        }
+    }
+    stats.hashSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    for (auto &group : groups) {
+        std::sort(group.begin(), group.end(), [&](size_t a, size_t b) { return files[a].path < files[b].path; });
+    }
+    auto wasted = [&](const std::vector<size_t> &group) { return files[group[0]].size * (group.size() - 1); };
+    std::stable_sort(groups.begin(), groups.end(), [&](const auto &a, const auto &b) { return wasted(a) > wasted(b); });
+    return groups;
+}
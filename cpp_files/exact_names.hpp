@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "index_format.hpp"
+
+// every distinct name of a shard in a hash table, next to the file index as .exact
+// "where is libfoo.so.3" hashes the name and probes a few slots instead of walking the trie of every directory
+// the table is open addressing with linear probing at most half full, a slot holds the full 64-bit hash of the
+// name and its id, so a probe only reads the name to confirm a hash that matches; a name id leads to its posting
+// list, the name blob entries with that name
+// names are compared lowercase, like the rest of the index
+// file layout: magic, slot count (a power of two), name count, posting count, name bytes, then the slots
+// (u64 hash, u32 name id + 1 with 0 for empty, u32 unused), the name offsets and posting starts (u32, names + 1 each),
+// the postings (u32 name blob entries) and the names
+
+const char EXACT_MAGIC[8] = {'F', 'F', 'E', 'X', 'A', 'C', 'T', '1'};
+
+struct ExactSlot {
+    uint64_t hash;
+    uint32_t name;  // id + 1, 0 is an empty slot
+    uint32_t unused;
+};
+
+inline std::string lowerName(const std::string &name) {
+    std::string lower(name.size(), '\0');
+    std::transform(name.begin(), name.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return lower;
+}
+
+inline bool writeExactNames(const std::string &file, const NameBlob &blob) {
+    // postings grouped by name, in blob order within a name
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+    std::vector<std::vector<uint32_t>> postings;
+    for (size_t i = 0; i < blob.entries.size(); i++) {
+        const NameEntry &entry = blob.entries[i];
+        auto found = ids.emplace(blob.lower.substr(entry.offset, entry.length), static_cast<uint32_t>(names.size()));
+        if (found.second) {
+            names.push_back(found.first->first);
+            postings.emplace_back();
+        }
+        postings[found.first->second].push_back(static_cast<uint32_t>(i));
+    }
+
+    uint64_t slotCount = 16;
+    while (slotCount < 2 * names.size()) {
+        slotCount *= 2;
+    }
+    std::vector<ExactSlot> slots(slotCount, ExactSlot{0, 0, 0});
+    std::vector<uint32_t> nameOffsets = {0}, postingStarts = {0}, flat;
+    std::string text;
+    for (uint32_t id = 0; id < names.size(); id++) {
+        uint64_t hash = pathHash(names[id]);
+        uint64_t slot = hash & (slotCount - 1);
+        while (slots[slot].name != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = {hash, id + 1, 0};
+        text += names[id];
+        nameOffsets.push_back(static_cast<uint32_t>(text.size()));
+        flat.insert(flat.end(), postings[id].begin(), postings[id].end());
+        postingStarts.push_back(static_cast<uint32_t>(flat.size()));
+    }
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t header[4] = {slotCount, names.size(), flat.size(), text.size()};
+    auto put = [fp](const std::vector<uint32_t> &values) { return fwrite(values.data(), sizeof(uint32_t), values.size(), fp) == values.size(); };
+    bool ok = fwrite(EXACT_MAGIC, 1, sizeof(EXACT_MAGIC), fp) == sizeof(EXACT_MAGIC) && fwrite(header, sizeof(header), 1, fp) == 1 &&
+              fwrite(slots.data(), sizeof(ExactSlot), slots.size(), fp) == slots.size() && put(nameOffsets) && put(postingStarts) && put(flat) &&
+              fwrite(text.data(), 1, text.size(), fp) == text.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// read-only view of a .exact file, usually a memory mapping
+class ExactNames {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint64_t header[4];
+        if (fileSize < sizeof(EXACT_MAGIC) + sizeof(header) || memcmp(file, EXACT_MAGIC, sizeof(EXACT_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(EXACT_MAGIC), sizeof(header));
+        slotCount = header[0];
+        nameCount = header[1];
+        if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0) {
+            return false;
+        }
+        slots = reinterpret_cast<const ExactSlot *>(file + sizeof(EXACT_MAGIC) + sizeof(header));
+        nameOffsets = reinterpret_cast<const uint32_t *>(slots + slotCount);
+        postingStarts = nameOffsets + nameCount + 1;
+        postings = postingStarts + nameCount + 1;
+        text = reinterpret_cast<const char *>(postings + header[2]);
+        return text + header[3] == file + fileSize;
+    }
+
+    size_t names() const { return nameCount; }
+
+    // the name blob entries named name (any case), [begin, end) of one posting list, empty when there is none
+    std::pair<const uint32_t *, const uint32_t *> find(const std::string &name) const {
+        std::string key = lowerName(name);
+        uint64_t hash = pathHash(key);
+        for (uint64_t slot = hash & (slotCount - 1);; slot = (slot + 1) & (slotCount - 1)) {
+            const ExactSlot &each = slots[slot];
+            if (each.name == 0) {
+                return {postings, postings};
+            }
+            uint32_t id = each.name - 1;
+            if (each.hash == hash && nameOffsets[id + 1] - nameOffsets[id] == key.size() &&
+                memcmp(text + nameOffsets[id], key.data(), key.size()) == 0) {
+                return {postings + postingStarts[id], postings + postingStarts[id + 1]};
+            }
+        }
+    }
+
+    // the name with the given id, ids are the order names were first seen in the blob
+    std::string name(size_t id) const { return std::string(text + nameOffsets[id], nameOffsets[id + 1] - nameOffsets[id]); }
+
+   private:
+    uint64_t slotCount = 0;
+    uint64_t nameCount = 0;
+    const ExactSlot *slots = nullptr;
+    const uint32_t *nameOffsets = nullptr;
+    const uint32_t *postingStarts = nullptr;
+    const uint32_t *postings = nullptr;
+    const char *text = nullptr;
+};
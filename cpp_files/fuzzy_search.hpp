@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "autocomplete.hpp"
+#include "index_trie.hpp"
+
+// fuzzy name search: every name whose trie key is within maxDistance edits (insert, delete, substitute) of the query
+// the query is compiled into a levenshtein automaton simulated bit-parallel (one bit mask of pattern positions per
+// error count), which is stepped along the trie edges, so a subtree is dropped as soon as no state is alive
+
+struct FuzzyMatch {
+    std::string path;
+    int distance;
+};
+
+const size_t FUZZY_MAX_QUERY = 63;
+const int FUZZY_MAX_DISTANCE = 2;
+
+class LevenshteinAutomaton {
+   public:
+    // bit i of a state mask: the first i characters of the pattern are matched
+    struct State {
+        uint64_t rows[FUZZY_MAX_DISTANCE + 1];
+    };
+
+    LevenshteinAutomaton(const std::string &pattern, int maxDistance) : length(pattern.size()), maxDistance(maxDistance) {
+        for (size_t i = 0; i < length; i++) {
+            charMask[static_cast<unsigned char>(pattern[i])] |= 1ull << (i + 1);
+        }
+        full = length == 63 ? ~0ull : (1ull << (length + 1)) - 1;
+    }
+
+    // with e errors the first e pattern characters can already be deleted
+    State start() const {
+        State state;
+        for (int e = 0; e <= maxDistance; e++) {
+            state.rows[e] = ((1ull << (e + 1)) - 1) & full;
+        }
+        return state;
+    }
+
+    State step(const State &state, char c) const {
+        uint64_t mask = charMask[static_cast<unsigned char>(c)];
+        State next;
+        next.rows[0] = (state.rows[0] << 1) & mask;
+        for (int e = 1; e <= maxDistance; e++) {
+            // match | insertion | substitution | deletion
+            next.rows[e] = (((state.rows[e] << 1) & mask) | state.rows[e - 1] | (state.rows[e - 1] << 1) | (next.rows[e - 1] << 1)) & full;
+        }
+        return next;
+    }
+
+    bool alive(const State &state) const { return state.rows[maxDistance] != 0; }
+
+    // smallest error count that matched the whole pattern, -1 if none
+    int distance(const State &state) const {
+        for (int e = 0; e <= maxDistance; e++) {
+            if (state.rows[e] & (1ull << length)) {
+                return e;
+            }
+        }
+        return -1;
+    }
+
+   private:
+    size_t length;
+    int maxDistance;
+    uint64_t full;
+    uint64_t charMask[256] = {};
+};
+
+inline void fuzzyTrie(yyjson_val *node, const LevenshteinAutomaton &automaton, const LevenshteinAutomaton::State &state,
+                      const std::string &dirPath, std::vector<FuzzyMatch> &out, size_t &nodesVisited) {
+    nodesVisited++;
+    yyjson_val *key, *value;
+    size_t idx, max;
+    yyjson_obj_foreach(node, idx, max, key, value) {
+        if (isTrieKey(key) && yyjson_is_obj(value)) {
+            LevenshteinAutomaton::State next = automaton.step(state, yyjson_get_str(key)[0]);
+            if (automaton.alive(next)) {
+                fuzzyTrie(value, automaton, next, dirPath, out, nodesVisited);
+            }
+        } else if (yyjson_is_arr(value)) {
+            int distance = automaton.distance(state);
+            if (distance >= 0) {
+                yyjson_val *each;
+                size_t arrIdx, arrMax;
+                yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                    out.push_back({dirPath + yyjson_get_str(each), distance});
+                }
+            }
+        }
+    }
+}
+
+// the matches below "scopes", closest first
+inline std::vector<FuzzyMatch> fuzzySearch(const std::vector<DirRef> &scopes, const std::string &query, int maxDistance, size_t &nodesVisited) {
+    std::vector<FuzzyMatch> matches;
+    if (query.size() > FUZZY_MAX_QUERY) {
+        return matches;
+    }
+    LevenshteinAutomaton automaton(query, std::min(maxDistance, FUZZY_MAX_DISTANCE));
+    LevenshteinAutomaton::State start = automaton.start();
+
+    std::vector<DirRef> level = scopes;
+    while (!level.empty()) {
+        std::vector<DirRef> next;
+        for (const auto &[dir, dirPath] : level) {
+            nodesVisited++;
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, key, value) {
+                if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value)) {
+                    next.push_back({value, dirPath + yyjson_get_str(key)});
+                } else if (isTrieKey(key) && yyjson_is_obj(value)) {
+                    LevenshteinAutomaton::State state = automaton.step(start, yyjson_get_str(key)[0]);
+                    if (automaton.alive(state)) {
+                        fuzzyTrie(value, automaton, state, dirPath, matches, nodesVisited);
+                    }
+                }
+            }
+        }
+        level.swap(next);
+    }
+
+    std::stable_sort(matches.begin(), matches.end(), [](const FuzzyMatch &a, const FuzzyMatch &b) { return a.distance < b.distance; });
+    return matches;
+}
+
+// ---- baseline for --bench: compute the edit distance of every name ----
+
+inline int editDistance(const std::string &a, const std::string &b) {
+    std::vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) {
+        row[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= a.size(); i++) {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= b.size(); j++) {
+            int above = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1])});
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+inline void bruteForceTrie(yyjson_val *node, std::string &key, const std::string &query, int maxDistance, const std::string &dirPath,
+                           std::vector<FuzzyMatch> &out) {
+    yyjson_val *name, *value;
+    size_t idx, max;
+    yyjson_obj_foreach(node, idx, max, name, value) {
+        if (isTrieKey(name) && yyjson_is_obj(value)) {
+            key.push_back(yyjson_get_str(name)[0]);
+            bruteForceTrie(value, key, query, maxDistance, dirPath, out);
+            key.pop_back();
+        } else if (yyjson_is_arr(value)) {
+            int distance = editDistance(key, query);
+            if (distance <= maxDistance) {
+                yyjson_val *each;
+                size_t arrIdx, arrMax;
+                yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                    out.push_back({dirPath + yyjson_get_str(each), distance});
+                }
+            }
+        }
+    }
+}
+
+inline std::vector<FuzzyMatch> bruteForceFuzzy(const std::vector<DirRef> &scopes, const std::string &query, int maxDistance) {
+    std::vector<FuzzyMatch> matches;
+    std::vector<DirRef> level = scopes;
+    std::string key;
+    while (!level.empty()) {
+        std::vector<DirRef> next;
+        for (const auto &[dir, dirPath] : level) {
+            yyjson_val *name, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, name, value) {
+                if (isDirKey(yyjson_get_str(name), yyjson_get_len(name)) && yyjson_is_obj(value)) {
+                    next.push_back({value, dirPath + yyjson_get_str(name)});
+                } else if (isTrieKey(name) && yyjson_is_obj(value)) {
+                    key.assign(yyjson_get_str(name), 1);
+                    bruteForceTrie(value, key, query, maxDistance, dirPath, matches);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const FuzzyMatch &a, const FuzzyMatch &b) { return a.distance < b.distance; });
+    return matches;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "index_trie.hpp"
+
+// glob patterns on file names: "*" any run of characters, "?" one character, "[abc]", "[a-z]" and "[!abc]" sets,
+// matched case-insensitively against the whole name
+// instead of testing every name, the literal start of the pattern is walked down the name trie, or a literal
+// extension ("*.log") is looked up in the extension trie, and only the names found there are matched
+
+// minimum trie key of the literal start before it is preferred over a literal extension
+const size_t GLOB_MIN_PREFIX = 3;
+
+class Glob {
+   public:
+    explicit Glob(const std::string &pattern) : pattern(pattern) {
+        // literal start, only up to the first '.' because the name trie holds stems and a dot may end the stem
+        size_t literalEnd = pattern.find_first_of("*?[.");
+        prefix = trieKeyOf(pattern.substr(0, literalEnd));
+
+        // literal extension, the part after the last '.' when it has no wildcards
+        size_t dot = pattern.find_last_of('.');
+        if (dot != std::string::npos && dot + 1 < pattern.size() && pattern.find_first_of("*?[", dot) == std::string::npos) {
+            extension = trieKeyOf(pattern.substr(dot + 1));
+        }
+    }
+
+    static bool isGlob(const std::string &text) { return text.find_first_of("*?[") != std::string::npos; }
+
+    const std::string &prefixKey() const { return prefix; }
+    const std::string &extensionKey() const { return extension; }
+    bool usesExtension() const { return !extension.empty() && prefix.size() < GLOB_MIN_PREFIX; }
+
+    bool matches(const char *name, size_t length) const {
+        // on a mismatch go back to the last '*' and let it swallow one more character
+        size_t p = 0, n = 0, starP = std::string::npos, starN = 0;
+        while (n < length) {
+            if (p < pattern.size() && pattern[p] == '*') {
+                starP = p++;
+                starN = n;
+                continue;
+            }
+            size_t next = p;
+            if (p < pattern.size() && matchOne(p, name[n], next)) {
+                p = next;
+                n++;
+                continue;
+            }
+            if (starP == std::string::npos) {
+                return false;
+            }
+            p = starP + 1;
+            n = ++starN;
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+   private:
+    static char lower(char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+
+    // does the pattern element at p match c, next is set to the element after it
+    bool matchOne(size_t p, char c, size_t &next) const {
+        if (pattern[p] == '?') {
+            next = p + 1;
+            return true;
+        }
+        if (pattern[p] == '[') {
+            size_t end = pattern.find(']', p + 2);
+            if (end != std::string::npos) {
+                size_t i = p + 1;
+                bool negate = pattern[i] == '!' || pattern[i] == '^';
+                if (negate) {
+                    i++;
+                }
+                bool found = false;
+                for (; i < end; i++) {
+                    if (i + 2 < end && pattern[i + 1] == '-') {
+                        found |= lower(c) >= lower(pattern[i]) && lower(c) <= lower(pattern[i + 2]);
+                        i += 2;
+                    } else {
+                        found |= lower(c) == lower(pattern[i]);
+                    }
+                }
+                next = end + 1;
+                return found != negate;
+            }
+            // an unclosed '[' is a literal
+        }
+        next = p + 1;
+        return lower(pattern[p]) == lower(c);
+    }
+
+    std::string pattern;
+    std::string prefix;
+    std::string extension;
+};
+
+// every name below a trie node that matches the glob
+inline void globTrie(yyjson_val *node, const Glob &glob, const std::string &dirPath, std::vector<std::string> &out, size_t &nodesVisited) {
+    nodesVisited++;
+    yyjson_val *key, *value;
+    size_t idx, max;
+    yyjson_obj_foreach(node, idx, max, key, value) {
+        if (isTrieKey(key) && yyjson_is_obj(value)) {
+            globTrie(value, glob, dirPath, out, nodesVisited);
+        } else if (yyjson_is_arr(value)) {
+            yyjson_val *each;
+            size_t arrIdx, arrMax;
+            yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                if (glob.matches(yyjson_get_str(each), yyjson_get_len(each))) {
+                    out.push_back(dirPath + yyjson_get_str(each));
+                }
+            }
+        }
+    }
+}
+
+// fileScopes are the searched directory in the name indexes, extensionScopes in the extension indexes
+inline std::vector<std::string> globSearch(const Glob &glob, const std::vector<DirRef> &fileScopes, const std::vector<DirRef> &extensionScopes,
+                                           size_t &nodesVisited) {
+    std::vector<std::string> matches;
+    bool byExtension = glob.usesExtension() && !extensionScopes.empty();
+    std::vector<DirRef> level = byExtension ? extensionScopes : fileScopes;
+    while (!level.empty()) {
+        std::vector<DirRef> next;
+        for (const auto &[dir, dirPath] : level) {
+            nodesVisited++;
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, key, value) {
+                // the bloom filter of a directory covers its whole subtree, a miss skips all of it
+                if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value) &&
+                    (byExtension || bloomAllows(value, glob.prefixKey()))) {
+                    next.push_back({value, dirPath + yyjson_get_str(key)});
+                }
+            }
+
+            if (byExtension) {
+                // exactly this extension: the "END" of the node, not the longer extensions below it
+                yyjson_val *node = trieDescend(dir, glob.extensionKey());
+                yyjson_val *names = node ? yyjson_obj_get(node, "END") : nullptr;
+                yyjson_val *each;
+                size_t arrIdx, arrMax;
+                yyjson_arr_foreach(names, arrIdx, arrMax, each) {
+                    if (glob.matches(yyjson_get_str(each), yyjson_get_len(each))) {
+                        matches.push_back(dirPath + yyjson_get_str(each));
+                    }
+                }
+            } else if (glob.prefixKey().empty()) {
+                // nothing literal to narrow with, every trie of the directory is matched
+                yyjson_obj_foreach(dir, idx, max, key, value) {
+                    if (isTrieKey(key) && yyjson_is_obj(value)) {
+                        globTrie(value, glob, dirPath, matches, nodesVisited);
+                    }
+                }
+            } else if (yyjson_val *node = trieDescend(dir, glob.prefixKey())) {
+                globTrie(node, glob, dirPath, matches, nodesVisited);
+            }
+        }
+        level.swap(next);
+    }
+    return matches;
+}
+
+// ---- baseline for --bench: match the glob against every name ----
+inline std::vector<std::string> naiveGlob(const Glob &glob, const std::vector<DirRef> &fileScopes) {
+    std::vector<std::string> matches;
+    std::vector<DirRef> level = fileScopes;
+    size_t visited = 0;
+    while (!level.empty()) {
+        std::vector<DirRef> next;
+        for (const auto &[dir, dirPath] : level) {
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, key, value) {
+                if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value)) {
+                    next.push_back({value, dirPath + yyjson_get_str(key)});
+                } else if (isTrieKey(key) && yyjson_is_obj(value)) {
+                    globTrie(value, glob, dirPath, matches, visited);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    return matches;
+}
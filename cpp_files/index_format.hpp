@@ -0,0 +1,419 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// layouts of the binary side tables written next to the json indexes, shared by the indexer and the searcher
+
+// 64-bit FNV-1a hash, used to key directory paths ("C:/Users/") in the side tables
+inline uint64_t pathHash(const char *str, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t pathHash(const std::string &str) { return pathHash(str.data(), str.size()); }
+
+// 64-bit seek, fseek() only takes a long which is 32 bits on windows
+inline int seekFile(FILE *fp, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(fp, static_cast<long long>(offset), SEEK_SET);
+#else
+    return fseeko(fp, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+// lowercase and drop what the indexer drops, so a typed query can be walked down the trie
+inline std::string trieKeyOf(const std::string &text) {
+    std::string key;
+    for (char c : text) {
+        if (isalnum(static_cast<unsigned char>(c))) {
+            key += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    return key;
+}
+
+// true if a word of "name" starts at position i: the first character, after a separator ("_", "-", "." or a space),
+// a camelCase hump ("fooBar", "HTTPServer") or a change between letters and digits ("v2", "2x")
+inline bool isWordStart(const std::string &name, size_t i) {
+    if (i >= name.size() || !isalnum(static_cast<unsigned char>(name[i]))) {
+        return false;
+    }
+    if (i == 0) {
+        return true;
+    }
+    unsigned char prev = name[i - 1], c = name[i];
+    if (!isalnum(prev)) {
+        return true;
+    }
+    if (isdigit(prev) != isdigit(c) && (isdigit(prev) || isdigit(c))) {
+        return true;
+    }
+    if (islower(prev) && isupper(c)) {
+        return true;
+    }
+    // last capital of an acronym followed by a lowercase word: the "S" of "HTTPServer"
+    return isupper(prev) && isupper(c) && i + 1 < name.size() && islower(static_cast<unsigned char>(name[i + 1]));
+}
+
+// ---- word index ----
+// names are also indexed by every word after the first and by the initials of their words, so "fooBarBaz"
+// is found by "barbaz", "baz" and "fbb", in shard_XXXX.word.json which has the same layout as the file index
+const size_t WORD_MAX_KEYS = 8;
+
+// the extra trie keys of a name stem, without the key of the whole stem which the file index already holds
+inline std::vector<std::string> wordKeys(const std::string &stem) {
+    std::vector<std::string> keys;
+    std::string acronym;
+    for (size_t i = 0; i < stem.size(); i++) {
+        if (!isWordStart(stem, i)) {
+            continue;
+        }
+        acronym += static_cast<char>(tolower(static_cast<unsigned char>(stem[i])));
+        if (i == 0 || keys.size() >= WORD_MAX_KEYS) {
+            continue;
+        }
+        std::string key;
+        for (size_t j = i; j < stem.size(); j++) {
+            if (isalnum(static_cast<unsigned char>(stem[j]))) {
+                key += static_cast<char>(tolower(static_cast<unsigned char>(stem[j])));
+            }
+        }
+        keys.push_back(key);
+    }
+    // a single word has no acronym worth indexing
+    if (acronym.size() > 1 && std::find(keys.begin(), keys.end(), acronym) == keys.end()) {
+        keys.push_back(acronym);
+    }
+    return keys;
+}
+
+// ---- directory offset table ----
+// for every directory object in a json index: hash of its path -> byte range of its object in the json file
+// file layout: magic, size of the json file it belongs to, entry count, entries sorted by hash
+struct DirOffset {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t length;
+};
+
+const char OFFSET_TABLE_MAGIC[8] = {'F', 'F', 'D', 'I', 'R', 'O', 'F', '1'};
+
+// fileIndex.json --> fileIndex.<extension>, the binary tables written next to a json index
+inline std::string sidecarPath(const std::string &indexFile, const std::string &extension) {
+    size_t dot = indexFile.find_last_of('.');
+    return (dot == std::string::npos ? indexFile : indexFile.substr(0, dot)) + "." + extension;
+}
+
+const std::vector<std::string> SIDECAR_KINDS = {"offsets", "names", "columns", "usage", "paths", "louds", "dag", "exact", "suffix", "dirs"};
+
+// fileIndex.json --> fileIndex.offsets
+inline std::string offsetTablePath(const std::string &indexFile) { return sidecarPath(indexFile, "offsets"); }
+
+inline bool writeOffsetTable(const std::string &file, uint64_t indexSize, std::vector<DirOffset> &offsets) {
+    std::sort(offsets.begin(), offsets.end(), [](const DirOffset &a, const DirOffset &b) { return a.hash < b.hash; });
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t count = offsets.size();
+    bool ok = fwrite(OFFSET_TABLE_MAGIC, 1, sizeof(OFFSET_TABLE_MAGIC), fp) == sizeof(OFFSET_TABLE_MAGIC) &&
+              fwrite(&indexSize, sizeof(indexSize), 1, fp) == 1 &&
+              fwrite(&count, sizeof(count), 1, fp) == 1 &&
+              fwrite(offsets.data(), sizeof(DirOffset), offsets.size(), fp) == offsets.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// binary search the table on disk for "dir", only log(n) entries are read
+// returns false when there is no table, it was written for another version of the json file or the directory is not in it
+inline bool findDirOffset(const std::string &file, uint64_t indexSize, const std::string &dir, DirOffset &found) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    char magic[sizeof(OFFSET_TABLE_MAGIC)];
+    uint64_t tableIndexSize = 0, count = 0;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, OFFSET_TABLE_MAGIC, sizeof(magic)) != 0 ||
+        fread(&tableIndexSize, sizeof(tableIndexSize), 1, fp) != 1 || fread(&count, sizeof(count), 1, fp) != 1 ||
+        tableIndexSize != indexSize) {
+        fclose(fp);
+        return false;
+    }
+
+    const uint64_t entriesStart = sizeof(OFFSET_TABLE_MAGIC) + 2 * sizeof(uint64_t);
+    uint64_t hash = pathHash(dir);
+    uint64_t low = 0, high = count;
+    bool hit = false;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        DirOffset entry;
+        if (seekFile(fp, entriesStart + mid * sizeof(DirOffset)) != 0 || fread(&entry, sizeof(entry), 1, fp) != 1) {
+            break;
+        }
+        if (entry.hash == hash) {
+            found = entry;
+            hit = true;
+            break;
+        }
+        if (entry.hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    fclose(fp);
+    return hit;
+}
+
+// ---- name blob ----
+// every name of a file index packed into one buffer for brute force scans, next to the file index as .names
+// file layout: magic, directory count, entry count, directory bytes, name bytes,
+// directory offsets (count + 1), directory paths, entries, lowercase names, names
+// names are separated by '\n' in both blobs and an entry points at the same offset in each
+struct NameEntry {
+    uint64_t offset;  // first character of the name in the blobs
+    uint32_t length;
+    uint32_t dir;  // index into the directory paths
+};
+
+struct NameBlob {
+    std::vector<uint64_t> dirOffsets = {0};
+    std::string dirs;
+    std::vector<NameEntry> entries;
+    std::string lower;
+    std::string names;
+
+    size_t dirCount() const { return dirOffsets.size() - 1; }
+    std::string dirPath(size_t dir) const { return dirs.substr(dirOffsets[dir], dirOffsets[dir + 1] - dirOffsets[dir]); }
+    std::string path(size_t entry) const {
+        const NameEntry &each = entries[entry];
+        return dirPath(each.dir) + names.substr(each.offset, each.length);
+    }
+    // one flag per directory, set if it is searchDir or below it
+    std::vector<char> dirsBelow(const std::string &searchDir) const {
+        std::vector<char> below(dirCount());
+        for (size_t dir = 0; dir < dirCount(); dir++) {
+            // dirs runs on into the next directory, a shorter one must not be compared past its end
+            uint64_t length = dirOffsets[dir + 1] - dirOffsets[dir];
+            below[dir] = length >= searchDir.size() && dirs.compare(dirOffsets[dir], searchDir.size(), searchDir) == 0;
+        }
+        return below;
+    }
+
+    uint32_t addDir(const std::string &path) {
+        dirs += path;
+        dirOffsets.push_back(dirs.size());
+        return static_cast<uint32_t>(dirCount() - 1);
+    }
+    void addName(uint32_t dir, const char *name, size_t length) {
+        entries.push_back({names.size(), static_cast<uint32_t>(length), dir});
+        for (size_t i = 0; i < length; i++) {
+            lower += static_cast<char>(tolower(static_cast<unsigned char>(name[i])));
+        }
+        lower += '\n';
+        names.append(name, length);
+        names += '\n';
+    }
+};
+
+const char NAME_BLOB_MAGIC[8] = {'F', 'F', 'N', 'A', 'M', 'E', 'S', '1'};
+
+inline bool writeNameBlob(const std::string &file, const NameBlob &blob) {
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t header[4] = {blob.dirCount(), blob.entries.size(), blob.dirs.size(), blob.names.size()};
+    bool ok = fwrite(NAME_BLOB_MAGIC, 1, sizeof(NAME_BLOB_MAGIC), fp) == sizeof(NAME_BLOB_MAGIC) &&
+              fwrite(header, sizeof(header), 1, fp) == 1 &&
+              fwrite(blob.dirOffsets.data(), sizeof(uint64_t), blob.dirOffsets.size(), fp) == blob.dirOffsets.size() &&
+              fwrite(blob.dirs.data(), 1, blob.dirs.size(), fp) == blob.dirs.size() &&
+              fwrite(blob.entries.data(), sizeof(NameEntry), blob.entries.size(), fp) == blob.entries.size() &&
+              fwrite(blob.lower.data(), 1, blob.lower.size(), fp) == blob.lower.size() &&
+              fwrite(blob.names.data(), 1, blob.names.size(), fp) == blob.names.size();
+    return fclose(fp) == 0 && ok;
+}
+
+inline bool readNameBlob(const std::string &file, NameBlob &blob) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    char magic[sizeof(NAME_BLOB_MAGIC)];
+    uint64_t header[4];
+    bool ok = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, NAME_BLOB_MAGIC, sizeof(magic)) == 0 &&
+              fread(header, sizeof(header), 1, fp) == 1;
+    if (ok) {
+        blob.dirOffsets.resize(header[0] + 1);
+        blob.entries.resize(header[1]);
+        blob.dirs.resize(header[2]);
+        blob.lower.resize(header[3]);
+        blob.names.resize(header[3]);
+        ok = fread(blob.dirOffsets.data(), sizeof(uint64_t), blob.dirOffsets.size(), fp) == blob.dirOffsets.size() &&
+             fread(&blob.dirs[0], 1, blob.dirs.size(), fp) == blob.dirs.size() &&
+             fread(blob.entries.data(), sizeof(NameEntry), blob.entries.size(), fp) == blob.entries.size() &&
+             fread(&blob.lower[0], 1, blob.lower.size(), fp) == blob.lower.size() &&
+             fread(&blob.names[0], 1, blob.names.size(), fp) == blob.names.size();
+    }
+    fclose(fp);
+    return ok;
+}
+
+// the sections of a mapped .names file, used in place so a lookup only loads the pages of the names it reads
+// the entries follow the directory bytes and are not aligned, each one is copied out
+struct NameBlobView {
+    uint64_t directories = 0;
+    uint64_t count = 0;
+    const char *dirOffsets = nullptr;
+    const char *dirs = nullptr;
+    const char *entries = nullptr;
+    const char *lower = nullptr;
+    const char *names = nullptr;
+
+    bool open(const char *file, size_t fileSize) {
+        const size_t start = sizeof(NAME_BLOB_MAGIC) + 4 * sizeof(uint64_t);
+        if (!file || fileSize < start || memcmp(file, NAME_BLOB_MAGIC, sizeof(NAME_BLOB_MAGIC)) != 0) {
+            return false;
+        }
+        uint64_t header[4];
+        memcpy(header, file + sizeof(NAME_BLOB_MAGIC), sizeof(header));
+        // each section on its own fits in the file, so the sum below cannot overflow
+        if (header[0] >= fileSize || header[1] > fileSize / sizeof(NameEntry) || header[2] > fileSize || header[3] > fileSize ||
+            fileSize != start + (header[0] + 1) * sizeof(uint64_t) + header[2] + header[1] * sizeof(NameEntry) + 2 * header[3]) {
+            return false;
+        }
+        directories = header[0];
+        count = header[1];
+        dirOffsets = file + start;
+        dirs = dirOffsets + (directories + 1) * sizeof(uint64_t);
+        entries = dirs + header[2];
+        lower = entries + count * sizeof(NameEntry);
+        names = lower + header[3];
+        return true;
+    }
+
+    NameEntry entry(size_t i) const {
+        NameEntry each;
+        memcpy(&each, entries + i * sizeof(NameEntry), sizeof(each));
+        return each;
+    }
+    uint64_t dirOffset(size_t dir) const {
+        uint64_t offset;
+        memcpy(&offset, dirOffsets + dir * sizeof(uint64_t), sizeof(offset));
+        return offset;
+    }
+    std::string dirPath(size_t dir) const {
+        uint64_t first = dirOffset(dir);
+        return std::string(dirs + first, dirOffset(dir + 1) - first);
+    }
+    std::string path(size_t i) const {
+        NameEntry each = entry(i);
+        return dirPath(each.dir).append(names + each.offset, each.length);
+    }
+    // true if the directory is searchDir or below it
+    bool dirBelow(size_t dir, const std::string &searchDir) const {
+        uint64_t first = dirOffset(dir);
+        return dirOffset(dir + 1) - first >= searchDir.size() && memcmp(dirs + first, searchDir.data(), searchDir.size()) == 0;
+    }
+};
+
+// ---- shards ----
+// the index is split into one shard per top-level directory below each crawl root, listed in manifest.json
+// a flat shard only holds the entries directly inside its directory (files in the crawl root itself)
+// the files of a shard are named after the generation that wrote them, the manifest holds which one is live
+struct ShardInfo {
+    int id;
+    std::string prefix;  // directory path of the shard as used by the index --> "C:/Users/alice/"
+    bool flat;
+    uint64_t generation;  // 0 for the files of an index written before the names had a generation
+};
+
+const std::string MANIFEST_FILE = "manifest.json";
+
+// the json indexes every shard has: names, extensions and words of names
+const std::vector<std::string> INDEX_KINDS = {"file", "ext", "word"};
+
+// kind is one of INDEX_KINDS --> shard_0003.g12.file.json
+inline std::string shardFile(const std::string &indexDir, int id, const std::string &kind, uint64_t generation) {
+    char name[48];
+    if (generation == 0) {
+        snprintf(name, sizeof(name), "shard_%04d.", id);
+    } else {
+        snprintf(name, sizeof(name), "shard_%04d.g%llu.", id, static_cast<unsigned long long>(generation));
+    }
+    return indexDir + name + kind + ".json";
+}
+
+// true if the shard can hold entries below the search directory "scope"
+inline bool shardOverlaps(const ShardInfo &shard, const std::string &scope) {
+    // shard inside the searched directory, or the searched directory inside a (non flat) shard
+    if (shard.prefix.compare(0, scope.size(), scope) == 0) {
+        return true;
+    }
+    return !shard.flat && scope.compare(0, shard.prefix.size(), shard.prefix) == 0;
+}
+
+// ---- directory bloom filters ----
+// every directory object of a json index starts with a "BLOOM" key holding a hex encoded bloom filter
+// of the first BLOOM_PREFIX characters of every name in its subtree, so a search can skip a directory
+// when the prefix of the search term is definitely not below it
+const std::string BLOOM_KEY = "BLOOM";
+const size_t BLOOM_PREFIX = 3;
+const int BLOOM_HASHES = 6;
+const size_t BLOOM_BITS_PER_PREFIX = 10;
+const size_t BLOOM_MIN_BITS = 64;
+const size_t BLOOM_MAX_BITS = 8192;
+
+// bit positions by double hashing the two halves of the prefix hash, bits is a power of two
+inline size_t bloomBit(uint64_t hash, int i, size_t bits) {
+    uint32_t h1 = static_cast<uint32_t>(hash), h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    return (h1 + static_cast<uint32_t>(i) * h2) & (bits - 1);
+}
+
+// prefixHashes are pathHash() of the prefixes, the result is the hex string stored in the index
+inline std::string bloomBuild(const std::vector<uint64_t> &prefixHashes) {
+    size_t bits = BLOOM_MIN_BITS;
+    while (bits < prefixHashes.size() * BLOOM_BITS_PER_PREFIX && bits < BLOOM_MAX_BITS) {
+        bits *= 2;
+    }
+    std::vector<uint8_t> nibbles(bits / 4, 0);
+    for (uint64_t hash : prefixHashes) {
+        for (int i = 0; i < BLOOM_HASHES; i++) {
+            size_t bit = bloomBit(hash, i, bits);
+            nibbles[bit / 4] |= 1 << (bit % 4);
+        }
+    }
+    std::string hex(nibbles.size(), '0');
+    for (size_t i = 0; i < nibbles.size(); i++) {
+        hex[i] = "0123456789abcdef"[nibbles[i]];
+    }
+    return hex;
+}
+
+// false when no name below the directory starts with the (at most BLOOM_PREFIX long) prefix of userSearch
+inline bool bloomMayContain(const char *hex, size_t hexLength, const std::string &userSearch) {
+    size_t bits = hexLength * 4;
+    if (userSearch.empty() || bits == 0 || (bits & (bits - 1)) != 0) {
+        return true;
+    }
+    uint64_t hash = pathHash(userSearch.data(), std::min(userSearch.size(), BLOOM_PREFIX));
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        size_t bit = bloomBit(hash, i, bits);
+        char c = hex[bit / 4];
+        int nibble = c <= '9' ? c - '0' : c - 'a' + 10;
+        if (!(nibble & (1 << (bit % 4)))) {
+            return false;
+        }
+    }
+    return true;
+}
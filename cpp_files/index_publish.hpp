@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// crash safe publication of the index files
+// every publication is a new generation of the index: the shard files it writes have the generation in their name
+// (shard_0003.g12.file.json) and manifest.json lists the generation of every shard, so a file a manifest lists is
+// never written again; the files of the generation are synced, the manifest is written next to the published one,
+// synced and renamed over it, the one step that makes the whole generation live, and only then are the files no
+// manifest lists anymore deleted
+// a reader opens the files of the manifest it read and keeps them while the next generation is written, a crash
+// before the rename leaves the last generation as it was and the next run sweeps away the files of the one that
+// never got its manifest
+// on windows a file that is open can't be replaced or deleted: the rename of the manifest is retried for a while and
+// the last generation stays live when it stays busy, an old file that is still mapped is left to the next sweep
+
+const std::string STAGED_SUFFIX = ".tmp";
+// the index files the sweep may delete, named by shardFile
+const std::string SHARD_FILE_PREFIX = "shard_";
+const int PUBLISH_RETRIES = 10;
+
+// flushes a file, or the entries of a directory, to the disk
+inline bool syncPath(const std::string &path, bool directory = false) {
+#ifdef _WIN32
+    // ntfs journals the renames itself, and a directory can't be opened as a file
+    if (directory) {
+        return true;
+    }
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = _commit(fd) == 0;
+    return _close(fd) == 0 && ok;
+#else
+    int fd = open(path.c_str(), directory ? O_RDONLY : O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+#endif
+}
+
+// renames from over to, retried while to is held open by a reader that did not let it be replaced
+inline bool replaceFile(const std::string &from, const std::string &to) {
+    std::error_code ec;
+    for (int attempt = 0; attempt < PUBLISH_RETRIES; attempt++) {
+        std::filesystem::rename(from, to, ec);
+        if (!ec) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20 << std::min(attempt, 4)));
+    }
+    return false;
+}
+
+// the files written for the next generation, the indexer writes and publishes from one thread at a time
+class IndexPublisher {
+   public:
+    explicit IndexPublisher(std::string dir) : dir(std::move(dir)) {}
+
+    // the path to write a file of the next generation to, synced when it is published
+    // a file carried over as a hard link to an older generation is unlinked first, writing it leaves the older one as it is
+    std::string stage(const std::string &file) {
+        std::error_code ec;
+        std::filesystem::remove(file, ec);
+        if (std::find(written.begin(), written.end(), file) == written.end()) {
+            written.push_back(file);
+        }
+        return file;
+    }
+
+    // a file that could not be written is left out of the generation
+    void drop(const std::string &file) {
+        std::error_code ec;
+        std::filesystem::remove(file, ec);
+        written.erase(std::remove(written.begin(), written.end(), file), written.end());
+    }
+
+    // makes the manifest written to "<manifest>.tmp" the published one, live are the files it lists and every other
+    // shard file is deleted once it is published; false leaves it staged for the next try
+    bool publish(const std::string &manifest, const std::vector<std::string> &live) {
+        for (const auto &file : written) {
+            if (!syncPath(file)) {
+                return false;
+            }
+        }
+        if (!syncPath(dir, true) || !syncPath(manifest + STAGED_SUFFIX) || !replaceFile(manifest + STAGED_SUFFIX, manifest) || !syncPath(dir, true)) {
+            return false;
+        }
+        written.clear();
+        sweep(live);
+        return true;
+    }
+
+    // deletes the shard files live does not list and the temp files of an unfinished publication,
+    // the ones a reader still has open are left to the next sweep
+    void sweep(const std::vector<std::string> &live) {
+        std::unordered_set<std::string> keep;
+        for (const auto &file : live) {
+            keep.insert(std::filesystem::path(file).filename().string());
+        }
+        std::vector<std::filesystem::path> unused;
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            bool staged = name.size() > STAGED_SUFFIX.size() && name.compare(name.size() - STAGED_SUFFIX.size(), STAGED_SUFFIX.size(), STAGED_SUFFIX) == 0;
+            if ((staged || name.compare(0, SHARD_FILE_PREFIX.size(), SHARD_FILE_PREFIX) == 0) && keep.count(name) == 0) {
+                unused.push_back(entry.path());
+            }
+        }
+        for (const auto &path : unused) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+   private:
+    std::string dir;
+    std::vector<std::string> written;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "autocomplete.hpp"
+#include "index_format.hpp"
+#include "index_trie.hpp"
+
+// a long running searcher keeps one generation of the index loaded as a snapshot, and picks up a new one while
+// it keeps answering: the next generation is loaded on the side and published with one atomic pointer swap
+// a reader pins the current snapshot at the start of a query and keeps it until its next pin, so it never waits
+// for the loader and never sees half of one generation and half of the next
+// what is guaranteed: a pin is a few atomic loads and a store, no lock and no reference count, and a reader never
+// frees anything; the old generations are reclaimed by the writer (the thread that publishes, one at a time) once
+// every reader that could still hold them has pinned again or left, epoch based: each publication starts a new
+// epoch, a reader announces the epoch it pinned in, and a snapshot retired in epoch e is freed when no reader
+// announces an epoch before e; a reader that stops pinning holds back the generations retired after its last pin
+
+// one loaded generation: the parsed shards, their scopes and the completion index built over them
+struct IndexSnapshot {
+    uint64_t generation = 0;  // of the manifest the files were resolved from
+    bool complete = true;  // false when a shard could not be read
+    std::vector<std::string> files;
+    std::vector<yyjson_doc *> docs;
+    std::vector<DirRef> scopes;
+    CompletionIndex completion;
+
+    IndexSnapshot() = default;
+    IndexSnapshot(const IndexSnapshot &) = delete;
+    IndexSnapshot &operator=(const IndexSnapshot &) = delete;
+    ~IndexSnapshot() {
+        for (auto doc : docs) {
+            yyjson_doc_free(doc);
+        }
+    }
+};
+
+const size_t MAX_SNAPSHOT_READERS = 64;
+const uint64_t SNAPSHOT_IDLE = UINT64_MAX;
+
+class SnapshotStore {
+   public:
+    SnapshotStore() {
+        for (size_t i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+            pins[i] = SNAPSHOT_IDLE;
+            taken[i] = false;
+        }
+    }
+    SnapshotStore(const SnapshotStore &) = delete;
+    SnapshotStore &operator=(const SnapshotStore &) = delete;
+    ~SnapshotStore() {
+        delete snapshot.load();
+        for (const auto &each : retired) {
+            delete each.first;
+        }
+    }
+
+    // writer side, from one thread at a time: the previous snapshot is retired, not freed
+    void publish(std::unique_ptr<const IndexSnapshot> next) {
+        const IndexSnapshot *old = snapshot.exchange(next.release());
+        uint64_t retiredIn = epoch.fetch_add(1) + 1;
+        if (old) {
+            retired.push_back({old, retiredIn});
+        }
+    }
+
+    // frees the retired snapshots no reader can hold anymore, returns how many
+    size_t reclaim() {
+        uint64_t oldest = SNAPSHOT_IDLE;
+        for (size_t i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+            oldest = std::min(oldest, pins[i].load());
+        }
+        size_t freed = 0;
+        for (auto it = retired.begin(); it != retired.end();) {
+            if (it->second <= oldest) {
+                delete it->first;
+                it = retired.erase(it);
+                freed++;
+            } else {
+                ++it;
+            }
+        }
+        return freed;
+    }
+
+    // the snapshot last published, only for the writer, which is the one that frees them
+    const IndexSnapshot *latest() const { return snapshot.load(); }
+
+   private:
+    friend class SnapshotReader;
+
+    std::atomic<const IndexSnapshot *> snapshot{nullptr};
+    std::atomic<uint64_t> epoch{1};
+    std::atomic<uint64_t> pins[MAX_SNAPSHOT_READERS];
+    std::atomic<bool> taken[MAX_SNAPSHOT_READERS];
+    std::vector<std::pair<const IndexSnapshot *, uint64_t>> retired;
+};
+
+// one reader thread of a store, takes a slot for its pins while it lives
+class SnapshotReader {
+   public:
+    explicit SnapshotReader(SnapshotStore &store) : store(store) {
+        for (slot = 0;; slot = (slot + 1) % MAX_SNAPSHOT_READERS) {
+            bool expected = false;
+            if (store.taken[slot].compare_exchange_strong(expected, true)) {
+                break;
+            }
+            if (slot == MAX_SNAPSHOT_READERS - 1) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+    ~SnapshotReader() {
+        unpin();
+        store.taken[slot] = false;
+    }
+
+    // the current snapshot, valid until the next pin or unpin of this reader
+    // the epoch is announced before the pointer is read, a writer that misses the announcement has already swapped
+    // the pointer this load sees
+    const IndexSnapshot *pin() {
+        store.pins[slot] = store.epoch.load();
+        return store.snapshot.load();
+    }
+
+    void unpin() { store.pins[slot] = SNAPSHOT_IDLE; }
+
+   private:
+    SnapshotStore &store;
+    size_t slot = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "../libraries/yyjson.h"
+#include "index_format.hpp"
+
+// helpers to walk the yyjson DOM of a json index: directory objects hold "folder/" keys, a "BLOOM" filter
+// and the first characters of the character trie of their names, a trie node holds the next characters and
+// an "END" array with the names that end there
+
+// a directory to look at: its object in the index and its path
+typedef std::pair<yyjson_val *, std::string> DirRef;
+
+inline bool isDirKey(const char *key, size_t length) { return length > 0 && key[length - 1] == '/'; }
+
+// single character keys are trie edges, everything else is a directory, "END" or "BLOOM"
+inline bool isTrieKey(yyjson_val *key) { return yyjson_get_len(key) == 1; }
+
+inline bool bloomAllows(yyjson_val *dir, const std::string &userSearch) {
+    // indexes written without bloom filters are always traversed
+    yyjson_val *bloom = yyjson_obj_get(dir, BLOOM_KEY.c_str());
+    if (!bloom || !yyjson_is_str(bloom)) {
+        return true;
+    }
+    return bloomMayContain(yyjson_get_str(bloom), yyjson_get_len(bloom), userSearch);
+}
+
+// follow the characters of "prefix" down the trie of a directory, nullptr when no name starts with it
+inline yyjson_val *trieDescend(yyjson_val *node, const std::string &prefix) {
+    char key[2] = {0, 0};
+    for (size_t i = 0; node && i < prefix.size(); i++) {
+        key[0] = prefix[i];
+        node = yyjson_obj_getn(node, key, 1);
+    }
+    return node && yyjson_is_obj(node) ? node : nullptr;
+}
@@ -1,110 +1,591 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
-#include <regex>
+#include <set>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
 
 #include "../libraries/yyjson.h"
+#include "autocomplete.hpp"
+#include "batch_search.hpp"
+#include "content_search.hpp"
+#include "dag_index.hpp"
+#include "dir_index.hpp"
+#include "disk_usage.hpp"
+#include "duplicate_finder.hpp"
+#include "exact_names.hpp"
+#include "fuzzy_search.hpp"
+#include "glob_search.hpp"
+#include "index_format.hpp"
+#include "index_snapshot.hpp"
+#include "index_trie.hpp"
+#include "louds_trie.hpp"
+#include "metadata_columns.hpp"
+#include "name_scan.hpp"
+#include "path_dictionary.hpp"
+#include "ranking.hpp"
+#include "regex_search.hpp"
+#include "stream_search.hpp"
+#include "suffix_index.hpp"
 
 using namespace std;
 namespace fs = filesystem;
 
+// functions declarations
+SearchStatus domSearch(const string &file, const string &searchDir, const string &userSearch, ostream &out);
+vector<string> indexFilesFor(const string &searchDir, const string &kind);
+vector<string> indexFilesFor(const string &searchDir, const vector<string> &kinds, uint64_t &generation);
+vector<vector<string>> indexFilesByKind(const string &searchDir, const vector<string> &kinds, uint64_t &generation);
+yyjson_doc* loadIndex(const string &file, const string &searchDir, yyjson_val* &scope, SearchStatus &status);
+int completions(const vector<string> &files, uint64_t generation, const function<vector<string>(uint64_t&)> &resolveFiles, const string &searchDir, const string &userSearch, size_t k, chrono::microseconds budget, bool interactive, bool bench, bool printStats);
+unique_ptr<IndexSnapshot> loadSnapshot(const vector<string> &files, const string &searchDir, bool flatten);
+void snapshotBench(const vector<string> &files, const string &searchDir, size_t k, chrono::microseconds budget);
+vector<yyjson_doc*> loadScopes(const vector<string> &files, const string &searchDir, vector<DirRef> &scopes);
+int fuzzy(const vector<string> &files, const string &searchDir, const string &userSearch, int maxDistance, bool bench, bool printStats);
+int scan(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+int batch(const vector<string> &files, const string &searchDir, const string &batchFile, bool bench, bool printStats);
+int glob(const string &searchDir, const string &pattern, bool bench, bool printStats);
+int regexMode(const vector<string> &files, const string &searchDir, const string &pattern, bool bench, bool printStats);
+int metadata(const vector<string> &files, const string &searchDir, const string &userSearch, const MetaFilter &filter, bool regexTerm, const string &grepText, bool bench, bool printStats);
+int grep(const vector<string> &paths, const string &text, bool bench, bool printStats);
+int listPaths(const vector<string> &files, const string &searchDir, bool bench, bool printStats);
+int largest(const vector<string> &files, const string &searchDir, size_t n, bool bench, bool printStats);
+int duplicates(const vector<string> &files, const string &searchDir, const MetaFilter &filter, bool bench, bool printStats);
+int succinct(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+size_t countTrieNodes(yyjson_val *node);
+int dagSearch(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+int exact(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+int suffix(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+int directories(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats);
+vector<unique_ptr<MappedFile>> openSidecars(const vector<string> &files, const string &kind, const string &what, const function<bool(const string&, const MappedFile&)> &open);
+void printUsage();
+bool parseCount(const string &text, size_t &count);
+
+// where the indexer output is copied to
+const string INDEX_DIR = "C:/Users/josbu/OneDrive/Documents/GitHub/test_app/index/";
+
 int main(int argc, char* argv[]) {
+    // the app reports every file the user opens from the results, which ranks it higher from then on
+    if (argc == 3 && string(argv[1]) == "--opened") {
+        AccessStore access(INDEX_DIR + ACCESS_FILE);
+        return access.record(argv[2]) ? 0 : 1;
+    }
     if (argc < 3) {
-        cerr << "Usage: file_searcher <directory_path> <search_term>" << endl;
+        printUsage();
         return 1;
     }
 
     string searchDir = argv[1];
     string userSearch = argv[2];
+    // --batch FILE takes the place of the search term, one query per line of FILE ("-" reads stdin)
+    string batchFile;
+    int firstOption = 3;
+    if (userSearch == "--batch" && argc > 3) {
+        batchFile = argv[3];
+        userSearch = "";
+        firstOption = 4;
+    }
+    // --largest N lists the N directories below the directory that take the most space
+    size_t largestCount = 0;
+    if (userSearch == "--largest" && argc > 3) {
+        // 0 would leave an empty search term behind
+        if (!parseCount(argv[3], largestCount) || largestCount == 0) {
+            cerr << "Invalid number " << argv[3] << " for --largest" << endl;
+            printUsage();
+            return 1;
+        }
+        userSearch = "";
+        firstOption = 4;
+    }
+    // --duplicates lists the groups of identical files below the directory
+    bool findDuplicateFiles = false;
+    if (userSearch == "--duplicates") {
+        findDuplicateFiles = true;
+        userSearch = "";
+    }
+    // --paths lists every indexed path below the directory, sorted
+    bool listAll = false;
+    if (userSearch == "--paths") {
+        listAll = true;
+        userSearch = "";
+    }
+
+    // --stream scans the index without loading it into memory, for indexes larger than RAM
+    bool streamMode = false;
+    // --stats prints the number of index nodes visited and the search time to stderr
+    bool printStats = false;
+    // --complete K answers with the K best completions of the search term within --budget-us microseconds,
+    // --interactive keeps the index loaded and answers every line read from stdin as well, and picks up a rewritten
+    // index without stopping, --bench measures the latency while new generations are published
+    size_t completeCount = 0;
+    size_t budget = 1000;
+    bool interactive = false;
+    // --fuzzy D finds the names within D typos of the search term
+    int fuzzyDistance = -1;
+    // --scan finds the names containing the search term anywhere by scanning the name blobs instead of the tries
+    bool scanMode = false;
+    // --louds finds the names starting with the search term in the succinct tries instead of the json tries
+    bool loudsMode = false;
+    // --dag does what --scan does over the directory tree with the identical subtrees stored once
+    bool dagMode = false;
+    // --exact finds the names equal to the search term (any case) in the hash table of the names
+    bool exactMode = false;
+    // --suffix finds the names ending with the search term: "_test", ".tar.gz"
+    bool suffixMode = false;
+    // --dirs only finds directories, the names containing the search term in the directory index
+    bool dirsMode = false;
+    // --regex takes the search term as a regular expression over the full path
+    bool regexSearchMode = false;
+    // --words also matches the words inside names: "baz" and "fbb" find fooBarBaz
+    bool wordSearch = false;
+    // --rank K only prints the K most relevant results, best first
+    size_t rankCount = 0;
+    // --bench also runs the brute force version of the search and prints both timings
+    bool bench = false;
+    // --min-size 1G, --max-size 64K, --newer 1d, --older 2w and --type f|d|l keep the names whose metadata matches,
+    // answered from the metadata columns of the index: "*.log" --min-size 1G --newer 1d
+    MetaFilter filter;
+    // --grep TEXT searches the contents of the files the search term and the metadata options select
+    string grepText;
+    for (int i = firstOption; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--stream") {
+            streamMode = true;
+        } else if (option == "--stats") {
+            printStats = true;
+        } else if ((option == "--complete" || option == "--budget-us") && i + 1 < argc) {
+            size_t count = 0;
+            if (!parseCount(argv[++i], count)) {
+                cerr << "Invalid number " << argv[i] << " for " << option << endl;
+                printUsage();
+                return 1;
+            }
+            (option == "--complete" ? completeCount : budget) = count;
+        } else if (option == "--interactive") {
+            interactive = true;
+        } else if (option == "--fuzzy" && i + 1 < argc) {
+            size_t distance = 0;
+            if (!parseCount(argv[++i], distance) || distance < 1 || distance > FUZZY_MAX_DISTANCE) {
+                cerr << "Invalid distance " << argv[i] << " for --fuzzy, expected 1 to " << FUZZY_MAX_DISTANCE << endl;
+                printUsage();
+                return 1;
+            }
+            fuzzyDistance = static_cast<int>(distance);
+        } else if (option == "--regex") {
+            regexSearchMode = true;
+        } else if (option == "--scan") {
+            scanMode = true;
+        } else if (option == "--louds") {
+            loudsMode = true;
+        } else if (option == "--dag") {
+            dagMode = true;
+        } else if (option == "--exact") {
+            exactMode = true;
+        } else if (option == "--suffix") {
+            suffixMode = true;
+        } else if (option == "--dirs") {
+            dirsMode = true;
+        } else if (option == "--words") {
+            wordSearch = true;
+        } else if (option == "--rank" && i + 1 < argc) {
+            if (!parseCount(argv[++i], rankCount)) {
+                cerr << "Invalid number " << argv[i] << " for --rank" << endl;
+                printUsage();
+                return 1;
+            }
+        } else if (option == "--bench") {
+            bench = true;
+        } else if ((option == "--min-size" || option == "--max-size") && i + 1 < argc) {
+            uint64_t bytes = 0;
+            if (!parseSize(argv[++i], bytes)) {
+                cerr << "Invalid size " << argv[i] << endl;
+                return 1;
+            }
+            (option == "--min-size" ? filter.minSize : filter.maxSize) = bytes;
+        } else if ((option == "--newer" || option == "--older") && i + 1 < argc) {
+            int64_t age = 0;
+            if (!parseAge(argv[++i], age)) {
+                cerr << "Invalid age " << argv[i] << endl;
+                return 1;
+            }
+            (option == "--newer" ? filter.minMtime : filter.maxMtime) = unixNow() - age;
+        } else if (option == "--grep" && i + 1 < argc) {
+            grepText = argv[++i];
+        } else if (option == "--type" && i + 1 < argc) {
+            string type = argv[++i];
+            filter.type = type == "f" ? TYPE_FILE : type == "d" ? TYPE_DIRECTORY : type == "l" ? TYPE_SYMLINK : TYPE_UNKNOWN;
+            if (filter.type == TYPE_UNKNOWN) {
+                cerr << "Invalid type " << type << ", expected f, d or l" << endl;
+                return 1;
+            }
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+
+    // Normalize search directory path
+    replace(searchDir.begin(), searchDir.end(), '\\', '/');
+    if (searchDir.back() != '/') {
+        searchDir += '/';
+    }
+
+    // the index modes answer from their own sidecar, the options of the other searches would be ignored
+    vector<pair<bool, string>> indexModes = {{loudsMode, "--louds"}, {dagMode, "--dag"}, {exactMode, "--exact"}, {suffixMode, "--suffix"}, {dirsMode, "--dirs"}};
+    vector<pair<bool, string>> otherOptions = {{largestCount > 0 || listAll || findDuplicateFiles, "--largest, --paths and --duplicates"},
+                                               {!batchFile.empty(), "--batch"},
+                                               {wordSearch, "--words"},
+                                               {regexSearchMode, "--regex"},
+                                               {scanMode, "--scan"},
+                                               {fuzzyDistance >= 0, "--fuzzy"},
+                                               {completeCount > 0, "--complete"},
+                                               {rankCount > 0, "--rank"},
+                                               {streamMode, "--stream"},
+                                               {filter.active() || !grepText.empty(), "the metadata options"},
+                                               {Glob::isGlob(userSearch), "a glob"}};
+    string indexMode;
+    for (const auto &mode : indexModes) {
+        if (!mode.first) {
+            continue;
+        }
+        if (!indexMode.empty()) {
+            cerr << indexMode << " can't be combined with " << mode.second << endl;
+            return 1;
+        }
+        indexMode = mode.second;
+    }
+    if (!indexMode.empty()) {
+        for (const auto &option : otherOptions) {
+            if (option.first) {
+                cerr << indexMode << " can't be combined with " << option.second << endl;
+                return 1;
+            }
+        }
+        // the succinct tries and the shared subtrees only hold the file index, not the extension one
+        if ((loudsMode || dagMode) && userSearch[0] == '.') {
+            cerr << indexMode << " can't search an extension, use --suffix" << endl;
+            return 1;
+        }
+    }
+
+    // an option of one search can't be combined with the searches that would ignore it
+    auto ignored = [](bool set, const string &option, const vector<pair<bool, string>> &searches) {
+        for (const auto &search : searches) {
+            if (set && search.first) {
+                cerr << option << " can't be combined with " << search.second << endl;
+                return true;
+            }
+        }
+        return false;
+    };
+    // --stream only changes how the default search reads the json index
+    if (ignored(streamMode, "--stream", {{largestCount > 0 || listAll || findDuplicateFiles, "--largest, --paths and --duplicates"},
+                                         {!batchFile.empty(), "--batch"},
+                                         {regexSearchMode, "--regex"},
+                                         {scanMode, "--scan"},
+                                         {fuzzyDistance >= 0, "--fuzzy"},
+                                         {completeCount > 0, "--complete"},
+                                         {filter.active() || !grepText.empty(), "the metadata options"},
+                                         {Glob::isGlob(userSearch), "a glob"}})) {
+        return 1;
+    }
+    // --complete answers from the completion index alone, it neither widens nor reorders another search
+    if (ignored(completeCount > 0, "--complete", {{largestCount > 0 || listAll || findDuplicateFiles, "--largest, --paths and --duplicates"},
+                                                  {!batchFile.empty(), "--batch"},
+                                                  {regexSearchMode, "--regex"},
+                                                  {scanMode, "--scan"},
+                                                  {fuzzyDistance >= 0, "--fuzzy"},
+                                                  {wordSearch, "--words"},
+                                                  {rankCount > 0, "--rank"},
+                                                  {filter.active() || !grepText.empty(), "the metadata options"},
+                                                  {Glob::isGlob(userSearch), "a glob"}})) {
+        return 1;
+    }
+    // --rank only reorders the results of the default search and of --words
+    if (ignored(rankCount > 0, "--rank", {{largestCount > 0 || listAll || findDuplicateFiles, "--largest, --paths and --duplicates"},
+                                          {!batchFile.empty(), "--batch"},
+                                          {regexSearchMode, "--regex"},
+                                          {scanMode, "--scan"},
+                                          {fuzzyDistance >= 0, "--fuzzy"},
+                                          {filter.active() || !grepText.empty(), "the metadata options"},
+                                          {Glob::isGlob(userSearch), "a glob"}})) {
+        return 1;
+    }
+
+    if (largestCount > 0) {
+        return largest(indexFilesFor(searchDir, "file"), searchDir, largestCount, bench, printStats);
+    }
+    if (listAll) {
+        return listPaths(indexFilesFor(searchDir, "file"), searchDir, bench, printStats);
+    }
+    if (findDuplicateFiles) {
+        return duplicates(indexFilesFor(searchDir, "file"), searchDir, filter, bench, printStats);
+    }
+    if (!grepText.empty()) {
+        filter.type = TYPE_FILE;
+    }
+    if (filter.active()) {
+        // ".log" is the extension, like everywhere else
+        if (userSearch[0] == '.' && !regexSearchMode && !Glob::isGlob(userSearch)) {
+            userSearch = "*" + userSearch;
+        }
+        return metadata(indexFilesFor(searchDir, "file"), searchDir, userSearch, filter, regexSearchMode, grepText, bench, printStats);
+    }
+
+    // the whole name or its end, extension included: libfoo.so.3, .tar.gz
+    if (exactMode) {
+        return exact(indexFilesFor(searchDir, "file"), searchDir, userSearch, bench, printStats);
+    }
+    if (suffixMode) {
+        return suffix(indexFilesFor(searchDir, "file"), searchDir, userSearch, bench, printStats);
+    }
+    if (dirsMode) {
+        return directories(indexFilesFor(searchDir, "file"), searchDir, userSearch, bench, printStats);
+    }
 
+    // a search term with "*", "?" or "[" is a glob on the whole name: *.log, build_*, report-202?-*.csv
+    bool globSearch = !regexSearchMode && Glob::isGlob(userSearch);
     bool extensionSearch = false;
-    if (userSearch[0] == '.') {
+    if (userSearch[0] == '.' && !globSearch && !regexSearchMode) {
         userSearch = userSearch.substr(1);
         extensionSearch = true;
     }
-    string file = extensionSearch ? "C:/Users/josbu/OneDrive/Documents/GitHub/test_app/extIndex.json" : "C:\\Users\\josbu\\OneDrive\\Documents\\GitHub\\test_app\\fileIndex.json";
 
-    // Allocate a buffer for reading the file
-    FILE* fp = fopen(file.c_str(), "rb");
-    if (!fp) {
-        cerr << "Failed to open JSON file" << ' ' + file << endl;
-        return 1;
+    if (globSearch) {
+        return glob(searchDir, userSearch, bench, printStats);
+    }
+
+    // only the shards that can hold the searched directory are opened, all of one generation of the manifest
+    vector<string> kinds = {extensionSearch ? "ext" : "file"};
+    if (wordSearch && !extensionSearch) {
+        kinds.push_back("word");
+    }
+    auto resolveFiles = [&](uint64_t &generation) { return indexFilesFor(searchDir, kinds, generation); };
+    // the file index of the same shards comes along, the ranking reads the metadata columns next to it
+    uint64_t generation = 0;
+    vector<string> resolveKinds = kinds;
+    resolveKinds.push_back("file");
+    vector<vector<string>> resolved = indexFilesByKind(searchDir, resolveKinds, generation);
+    vector<string> files = {};
+    for (size_t i = 0; i < kinds.size(); i++) {
+        files.insert(files.end(), resolved[i].begin(), resolved[i].end());
+    }
+    const vector<string> &columnFiles = resolved.back();
+    if (!batchFile.empty()) {
+        return batch(files, searchDir, batchFile, bench, printStats);
+    }
+    if (regexSearchMode) {
+        return regexMode(files, searchDir, userSearch, bench, printStats);
     }
+    if (scanMode) {
+        return scan(files, searchDir, userSearch, bench, printStats);
+    }
+    if (loudsMode) {
+        return succinct(files, searchDir, userSearch, bench, printStats);
+    }
+    if (dagMode) {
+        return dagSearch(files, searchDir, userSearch, bench, printStats);
+    }
+    if (fuzzyDistance >= 0) {
+        return fuzzy(files, searchDir, userSearch, fuzzyDistance, bench, printStats);
+    }
+    if (completeCount > 0) {
+        return completions(files, generation, resolveFiles, searchDir, userSearch, completeCount, chrono::microseconds(budget), interactive, bench, printStats);
+    }
+    vector<SearchStatus> status(files.size(), SEARCH_NOT_FOUND);
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
 
-    fseek(fp, 0, SEEK_END);
-    size_t filesize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    // ranked results are collected first and only the best are printed at the end,
+    // word matches are collected too because a name can match several of its words
+    ostringstream collected;
+    ostream &results = rankCount > 0 || wordSearch ? collected : cout;
 
-    char* buffer = new char[filesize];
-    fread(buffer, 1, filesize, fp);
-    fclose(fp);
+    cout << "\n-----Results-----\n";
+    if (streamMode || files.size() <= 1) {
+        // streaming keeps one shard at a time in flight so memory stays bounded
+        for (size_t i = 0; i < files.size(); i++) {
+            status[i] = streamMode ? streamSearch(files[i], searchDir, userSearch, results) : domSearch(files[i], searchDir, userSearch, results);
+        }
+    } else {
+        // several shards are searched in parallel, each prints its results once it is done
+        mutex print_mutex;
+        atomic<size_t> next(0);
+        vector<thread> threads = {};
+        size_t threadCount = min<size_t>(files.size(), max(1u, thread::hardware_concurrency()));
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&]() {
+                for (size_t i = next++; i < files.size(); i = next++) {
+                    ostringstream shardResults;
+                    status[i] = domSearch(files[i], searchDir, userSearch, shardResults);
+                    unique_lock<mutex> guard(print_mutex);
+                    results << shardResults.str();
+                    results.flush();
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+    }
 
-    yyjson_doc* doc = yyjson_read(buffer, filesize, 0);
-    if (!doc) {
-        cerr << "Failed to load JSON file" << endl;
-        delete[] buffer;
-        return 1;
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    if (printStats) {
+        cerr << "Nodes visited: " << nodesVisited << ", elapsed time: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
     }
 
-    // Get the root object
-    yyjson_val* data = yyjson_doc_get_root(doc);
-    if (!yyjson_is_obj(data)) {
-        cerr << "Root is not a JSON object" << endl;
-        yyjson_doc_free(doc);
-        delete[] buffer;
-        return 1;
+    if (rankCount > 0 || wordSearch) {
+        begin = chrono::steady_clock::now();
+        AccessStore access(INDEX_DIR + ACCESS_FILE);
+        Ranker ranker(userSearch, searchDir, rankCount, access);
+        unordered_set<string> seen;
+        vector<string> lines;
+        istringstream collectedLines(collected.str());
+        string line;
+        while (getline(collectedLines, line)) {
+            if (wordSearch && !seen.insert(line).second) {
+                continue;
+            }
+            if (rankCount > 0) {
+                lines.push_back(line);
+            } else {
+                cout << line << '\n';
+            }
+        }
+        // the recency of every result from the metadata columns, which sit next to the file index of each shard
+        unordered_map<string, int64_t> mtimes;
+        for (const auto &each : lines) {
+            mtimes.emplace(each, RANK_NO_MTIME);
+        }
+        for (const auto &file : columnFiles) {
+            indexedMtimes(file, mtimes);
+        }
+        for (const auto &each : lines) {
+            ranker.add(each, mtimes[each]);
+        }
+        for (const auto &each : ranker.results()) {
+            cout << each.path << '\n';
+        }
+        cout.flush();
+        end = chrono::steady_clock::now();
+        if (printStats && rankCount > 0) {
+            cerr << "Ranked " << ranker.candidateCount() << " results in "
+                 << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+        }
     }
 
-    // Normalize search directory path
-    regex rep("\\\\");
-    searchDir = regex_replace(searchDir, rep, "/");
-    if (searchDir.back() != '/') {
-        searchDir += '/';
+    bool found = false, failed = false;
+    for (auto each : status) {
+        found |= each == SEARCH_OK;
+        failed |= each == SEARCH_FAILED;
+    }
+    if (!found && !failed) {
+        cout << "Directory " << searchDir << " not found or not indexed!" << endl;
     }
+    return found && !failed ? 0 : 1;
+}
 
-    // Traverse the JSON structure according to the directory path
-    size_t oldFind = 0;
-    size_t newFind = searchDir.find("/", oldFind + 1);
-    bool found = true;
+vector<string> indexFilesFor(const string &searchDir, const string &kind) {
+    uint64_t generation = 0;
+    return indexFilesFor(searchDir, vector<string>{kind}, generation);
+}
 
-    while (newFind != string::npos) {
-        string pth = searchDir.substr(oldFind, newFind - oldFind + 1);  // Get the current directory segment
-        found = false;
+vector<string> indexFilesFor(const string &searchDir, const vector<string> &kinds, uint64_t &generation) {
+    vector<string> files = {};
+    for (const auto &each : indexFilesByKind(searchDir, kinds, generation)) {
+        files.insert(files.end(), each.begin(), each.end());
+    }
+    return files;
+}
 
-        yyjson_val* next_obj = yyjson_obj_get(data, pth.c_str());
-        if (next_obj && yyjson_is_obj(next_obj)) {
-            data = next_obj;  // Move to the nested object
-            found = true;
+// the files of each of kinds, in the same order, read from one manifest
+vector<vector<string>> indexFilesByKind(const string &searchDir, const vector<string> &kinds, uint64_t &generation) {
+    // without a manifest the index is a single pair of json files, and there is no word index
+    yyjson_doc* manifest = yyjson_read_file((INDEX_DIR + MANIFEST_FILE).c_str(), 0, nullptr, nullptr);
+    if (!manifest) {
+        generation = 0;
+        vector<vector<string>> files(kinds.size());
+        for (size_t i = 0; i < kinds.size(); i++) {
+            if (kinds[i] != "word") {
+                files[i].push_back(kinds[i] == "ext" ? "C:/Users/josbu/OneDrive/Documents/GitHub/test_app/extIndex.json" : "C:\\Users\\josbu\\OneDrive\\Documents\\GitHub\\test_app\\fileIndex.json");
+            }
         }
+        return files;
+    }
 
-        if (!found) {
-            cout << "Directory " << pth << " not found or not indexed!" << endl;
-            yyjson_doc_free(doc);
-            delete[] buffer;
-            return 1;
+    // the files come from the manifest alone, every one it names was complete before it was published
+    yyjson_val* root = yyjson_doc_get_root(manifest);
+    generation = yyjson_get_uint(yyjson_obj_get(root, "generation"));
+    vector<ShardInfo> shards = {};
+    yyjson_val* each;
+    size_t idx, max;
+    yyjson_arr_foreach(yyjson_obj_get(root, "shards"), idx, max, each) {
+        // a hand edited or cut off manifest can have entries without a prefix, they can't be placed
+        const char* prefix = yyjson_get_str(yyjson_obj_get(each, "prefix"));
+        if (!prefix || !yyjson_is_int(yyjson_obj_get(each, "id"))) {
+            cerr << "Skipping manifest entry " << idx << " without an id or prefix" << endl;
+            continue;
+        }
+        ShardInfo shard = {(int)yyjson_get_int(yyjson_obj_get(each, "id")), prefix, yyjson_get_bool(yyjson_obj_get(each, "flat")),
+                           yyjson_get_uint(yyjson_obj_get(each, "generation"))};
+        if (shardOverlaps(shard, searchDir)) {
+            shards.push_back(shard);
         }
+    }
+    yyjson_doc_free(manifest);
 
-        oldFind = newFind + 1;
-        newFind = searchDir.find("/", oldFind);
+    vector<vector<string>> files(kinds.size());
+    for (size_t i = 0; i < kinds.size(); i++) {
+        for (const auto &shard : shards) {
+            files[i].push_back(shardFile(INDEX_DIR, shard.id, kinds[i], shard.generation));
+        }
+    }
+    return files;
+}
+
+SearchStatus domSearch(const string &file, const string &searchDir, const string &userSearch, ostream &out) {
+    yyjson_val* data = nullptr;
+    SearchStatus status;
+    yyjson_doc* doc = loadIndex(file, searchDir, data, status);
+    if (!doc) {
+        return status;
     }
 
     queue<tuple<yyjson_val*, string>> q;
-    q.push(make_tuple(data, searchDir));
+    if (bloomAllows(data, userSearch)) {
+        q.push(make_tuple(data, searchDir));
+    }
 
-    cout << "\n-----Results-----\n";
     while (!q.empty()) {
         auto [node, path] = q.front();
         q.pop();
+        nodesVisited++;
 
         yyjson_val *key, *value;
         size_t idx, max;
 
         yyjson_obj_foreach(node, idx, max, key, value) {
             string key_str = yyjson_get_str(key);
-            // Handle directories
+            // Handle directories, unless their bloom filter says nothing below can match
             if (key_str.back() == '/' && yyjson_is_obj(value)) {
-                q.push(make_tuple(value, path + key_str));
+                if (bloomAllows(value, userSearch)) {
+                    q.push(make_tuple(value, path + key_str));
+                }
+                continue;
+            }
+            if (key_str == BLOOM_KEY) {
                 continue;
             }
 
@@ -114,8 +595,8 @@ int main(int argc, char* argv[]) {
                 size_t arr_idx, arr_max;
 
                 yyjson_arr_foreach(value, arr_idx, arr_max, each) {
-                    cout << path.substr(0, path.find_last_of('/')+1) + string(yyjson_get_str(each)) + '\n';
-                    cout.flush();
+                    out << path.substr(0, path.find_last_of('/')+1) + string(yyjson_get_str(each)) + '\n';
+                    out.flush();
                 }
                 continue;
             }
@@ -138,7 +619,1441 @@ int main(int argc, char* argv[]) {
 
     // Clean up
     yyjson_doc_free(doc);
+
+    return SEARCH_OK;
+}
+
+// read and parse an index file and find the object of searchDir in it, the caller frees the returned document
+yyjson_doc* loadIndex(const string &file, const string &searchDir, yyjson_val* &scope, SearchStatus &status) {
+    // Allocate a buffer for reading the file
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        cerr << "Failed to open JSON file" << ' ' + file << endl;
+        status = SEARCH_FAILED;
+        return nullptr;
+    }
+
+    error_code ec;
+    uint64_t filesize = fs::file_size(file, ec);
+
+    // with a directory offset table only the object of the searched directory is read and parsed
+    DirOffset range;
+    bool seeked = !ec && findDirOffset(offsetTablePath(file), filesize, searchDir, range) && seekFile(fp, range.offset) == 0;
+    size_t readSize = seeked ? range.length : filesize;
+
+    char* buffer = new char[readSize];
+    fread(buffer, 1, readSize, fp);
+    fclose(fp);
+
+    // yyjson copies what it needs, the buffer can go right away
+    yyjson_doc* doc = yyjson_read(buffer, readSize, 0);
     delete[] buffer;
+    if (!doc) {
+        cerr << "Failed to load JSON file" << endl;
+        status = SEARCH_FAILED;
+        return nullptr;
+    }
+
+    // Get the root object
+    yyjson_val* data = yyjson_doc_get_root(doc);
+    if (!yyjson_is_obj(data)) {
+        cerr << "Root is not a JSON object" << endl;
+        yyjson_doc_free(doc);
+        status = SEARCH_FAILED;
+        return nullptr;
+    }
+
+    // Traverse the JSON structure according to the directory path, the seeked object already is the directory
+    size_t oldFind = 0;
+    size_t newFind = seeked ? string::npos : searchDir.find("/", oldFind + 1);
+    bool found = true;
+
+    while (newFind != string::npos) {
+        string pth = searchDir.substr(oldFind, newFind - oldFind + 1);  // Get the current directory segment
+        found = false;
+
+        yyjson_val* next_obj = yyjson_obj_get(data, pth.c_str());
+        if (next_obj && yyjson_is_obj(next_obj)) {
+            data = next_obj;  // Move to the nested object
+            found = true;
+        }
+
+        // the directory may still be in another shard
+        if (!found) {
+            yyjson_doc_free(doc);
+            status = SEARCH_NOT_FOUND;
+            return nullptr;
+        }
+
+        oldFind = newFind + 1;
+        newFind = searchDir.find("/", oldFind);
+    }
+
+    scope = data;
+    status = SEARCH_OK;
+    return doc;
+}
+
+
+int completions(const vector<string> &files, uint64_t generation, const function<vector<string>(uint64_t&)> &resolveFiles, const string &searchDir, const string &userSearch, size_t k, chrono::microseconds budget, bool interactive, bool bench, bool printStats) {
+    // the shards stay loaded so every keystroke only pays for the walk,
+    // a single query walks the trie, an interactive session flattens it once so every keystroke is a binary search
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    SnapshotStore store;
+    unique_ptr<IndexSnapshot> first = loadSnapshot(files, searchDir, interactive);
+    first->generation = generation;
+    store.publish(move(first));
+    if (store.latest()->scopes.empty()) {
+        cout << "Directory " << searchDir << " not found or not indexed!" << endl;
+        return 1;
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    if (printStats && interactive) {
+        cerr << "Completion index: " << store.latest()->completion.size() << " names, built in "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench && interactive) {
+        snapshotBench(files, searchDir, k, budget);
+        return 0;
+    }
+
+    // while the session runs, a rewritten index is loaded on the side and swapped in between two keystrokes,
+    // the reloader also frees the generations the keystrokes are done with so they never pay for it
+    atomic<bool> done(false);
+    thread reloader;
+    if (interactive) {
+        reloader = thread([&]() {
+            while (!done) {
+                this_thread::sleep_for(chrono::milliseconds(200));
+                store.reclaim();
+                // the files of a generation are never rewritten, only a new manifest brings new ones
+                uint64_t nextGeneration = 0;
+                vector<string> nextFiles = resolveFiles(nextGeneration);
+                if (nextGeneration == store.latest()->generation) {
+                    continue;
+                }
+                // the indexer deletes the files of a generation once a newer one is published: a load that lost
+                // one of them is dropped and the old snapshot kept until the next check finds the newer manifest
+                chrono::steady_clock::time_point loadBegin = chrono::steady_clock::now();
+                unique_ptr<IndexSnapshot> next = loadSnapshot(nextFiles, searchDir, true);
+                if (!next->complete) {
+                    continue;
+                }
+                next->generation = nextGeneration;
+                store.publish(move(next));
+                store.reclaim();
+                if (printStats) {
+                    cerr << "Index generation " << nextGeneration << " loaded in "
+                         << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - loadBegin).count() / 1000.0 << " ms" << endl;
+                }
+            }
+        });
+    }
+
+    // each line is what is in the search box now, usually the previous line plus or minus a character
+    SnapshotReader reader(store);
+    const IndexSnapshot *snapshot = nullptr;
+    unique_ptr<TypeAheadSession> session;
+    vector<double> latencies = {};
+    string query = userSearch;
+    do {
+        begin = chrono::steady_clock::now();
+        // the keystroke runs on the generation current when it starts, a new one starts a new session
+        const IndexSnapshot *current = reader.pin();
+        if (current != snapshot) {
+            snapshot = current;
+            session = make_unique<TypeAheadSession>(snapshot->completion);
+        }
+        CompletionResult result = interactive ? session->type(trieKeyOf(query), k, budget) : autocomplete(snapshot->scopes, trieKeyOf(query), k, budget);
+        end = chrono::steady_clock::now();
+        latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(end - begin).count() / 1000.0);
+
+        // one completion per line, an empty line ends the answer
+        for (const auto &each : result.completions) {
+            cout << each.path << '\n';
+        }
+        cout << endl;
+        if (printStats) {
+            cerr << result.completions.size() << " completions, nodes visited: " << result.nodesVisited << ", elapsed time: "
+                 << latencies.back() << " us" << (result.truncated ? " (budget exceeded)" : "");
+            if (interactive) {
+                cerr << ", reused prefix: " << session->reusedCharacters() << ", generation: " << snapshot->generation;
+            }
+            cerr << endl;
+        }
+    } while (interactive && getline(cin, query));
+    done = true;
+    if (reloader.joinable()) {
+        reloader.join();
+    }
+
+    if (printStats && latencies.size() > 1) {
+        sort(latencies.begin(), latencies.end());
+        cerr << "Queries: " << latencies.size() << ", p50: " << latencies[latencies.size() / 2]
+             << " us, p99: " << latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)] << " us" << endl;
+    }
+    return 0;
+}
+
+unique_ptr<IndexSnapshot> loadSnapshot(const vector<string> &files, const string &searchDir, bool flatten) {
+    auto snapshot = make_unique<IndexSnapshot>();
+    snapshot->files = files;
+    for (const auto &file : files) {
+        yyjson_val* scope = nullptr;
+        SearchStatus status;
+        yyjson_doc* doc = loadIndex(file, searchDir, scope, status);
+        if (doc) {
+            snapshot->docs.push_back(doc);
+            snapshot->scopes.push_back({scope, searchDir});
+        } else if (status == SEARCH_FAILED) {
+            snapshot->complete = false;
+        }
+    }
+    if (flatten) {
+        for (const auto &scope : snapshot->scopes) {
+            snapshot->completion.add(scope.first, scope.second);
+        }
+        snapshot->completion.build();
+    }
+    return snapshot;
+}
+
+void snapshotBench(const vector<string> &files, const string &searchDir, size_t k, chrono::microseconds budget) {
+    // every two character prefix typed one keystroke at a time, over and over for each phase
+    vector<string> keystrokes;
+    const string alphabet = "abcdefghijklmnopqrstuvwxyz0123456789";
+    for (char a : alphabet) {
+        for (char b : alphabet) {
+            keystrokes.push_back(string(1, a));
+            keystrokes.push_back(string(1, a) + b);
+        }
+    }
+    const chrono::milliseconds PHASE(2000);
+    auto report = [](const string &phase, vector<double> &latencies, uint64_t generations) {
+        sort(latencies.begin(), latencies.end());
+        cerr << phase << ": " << latencies.size() << " keystrokes, p50: " << latencies[latencies.size() / 2]
+             << " us, p99: " << latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)] << " us, max: " << latencies.back()
+             << " us, generations published: " << generations << endl;
+    };
+
+    // 1. no writer, and 2. a writer publishing new generations as fast as it can load them
+    for (bool writing : {false, true}) {
+        SnapshotStore store;
+        store.publish(loadSnapshot(files, searchDir, true));
+        atomic<bool> done(false);
+        atomic<uint64_t> generations(0);
+        thread writer;
+        if (writing) {
+            // the writer frees the old generations as well, like the reloader of a session
+            writer = thread([&]() {
+                while (!done) {
+                    store.publish(loadSnapshot(files, searchDir, true));
+                    store.reclaim();
+                    generations++;
+                }
+            });
+        }
+        // everything a keystroke pays for is timed, the session it drops included
+        SnapshotReader reader(store);
+        vector<double> latencies;
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now() + PHASE;
+        while (chrono::steady_clock::now() < stop) {
+            for (const auto &keystroke : keystrokes) {
+                chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+                {
+                    TypeAheadSession session(reader.pin()->completion);
+                    session.type(keystroke, k, budget);
+                }
+                latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count() / 1000.0);
+            }
+        }
+        done = true;
+        if (writer.joinable()) {
+            writer.join();
+        }
+        report(writing ? "Snapshot swap, writer loading" : "No writer", latencies, generations);
+    }
+
+    // 3. the same writer rebuilding one shared index in place under a readers-writer lock, freeing the old one under it
+    unique_ptr<IndexSnapshot> shared = loadSnapshot(files, searchDir, true);
+    shared_mutex lock;
+    atomic<bool> done(false);
+    atomic<uint64_t> generations(0);
+    thread writer([&]() {
+        while (!done) {
+            unique_lock<shared_mutex> guard(lock);
+            shared = loadSnapshot(files, searchDir, true);
+            generations++;
+        }
+    });
+    vector<double> latencies;
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now() + PHASE;
+    while (chrono::steady_clock::now() < stop) {
+        for (const auto &keystroke : keystrokes) {
+            chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+            {
+                shared_lock<shared_mutex> guard(lock);
+                TypeAheadSession session(shared->completion);
+                session.type(keystroke, k, budget);
+            }
+            latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count() / 1000.0);
+        }
+    }
+    done = true;
+    writer.join();
+    report("Readers-writer lock, writer loading", latencies, generations);
+}
+
+// load every shard that holds searchDir, the caller frees the returned documents
+vector<yyjson_doc*> loadScopes(const vector<string> &files, const string &searchDir, vector<DirRef> &scopes) {
+    vector<yyjson_doc*> docs = {};
+    for (const auto &file : files) {
+        yyjson_val* scope = nullptr;
+        SearchStatus status;
+        yyjson_doc* doc = loadIndex(file, searchDir, scope, status);
+        if (doc) {
+            docs.push_back(doc);
+            scopes.push_back({scope, searchDir});
+        }
+    }
+    return docs;
+}
+
+int fuzzy(const vector<string> &files, const string &searchDir, const string &userSearch, int maxDistance, bool bench, bool printStats) {
+    vector<DirRef> scopes = {};
+    vector<yyjson_doc*> docs = loadScopes(files, searchDir, scopes);
+    if (scopes.empty()) {
+        cout << "Directory " << searchDir << " not found or not indexed!" << endl;
+        return 1;
+    }
+
+    string query = trieKeyOf(userSearch);
+    size_t visited = 0;
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<FuzzyMatch> matches = fuzzySearch(scopes, query, maxDistance, visited);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    cout << "\n-----Results-----\n";
+    for (const auto &each : matches) {
+        cout << each.path << '\n';
+    }
+    cout.flush();
 
+    if (printStats || bench) {
+        cerr << matches.size() << " matches, nodes visited: " << visited << ", elapsed time: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench) {
+        begin = chrono::steady_clock::now();
+        vector<FuzzyMatch> baseline = bruteForceFuzzy(scopes, query, maxDistance);
+        end = chrono::steady_clock::now();
+        cerr << "Brute force: " << baseline.size() << " matches, elapsed time: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+
+    for (auto doc : docs) {
+        yyjson_doc_free(doc);
+    }
+    return 0;
+}
+
+int scan(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    string query = userSearch;
+    transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<NameBlob> blobs(files.size());
+    bool loaded = false;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (readNameBlob(sidecarPath(files[i], "names"), blobs[i])) {
+            loaded = true;
+        } else {
+            cerr << "No name blob for " << files[i] << ", run the indexer again" << endl;
+        }
+    }
+    if (!loaded) {
+        return 1;
+    }
+    chrono::steady_clock::time_point scanBegin = chrono::steady_clock::now();
+
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    vector<vector<uint32_t>> matches(blobs.size());
+    for (size_t i = 0; i < blobs.size(); i++) {
+        matches[i] = scanNames(blobs[i], searchDir, query, threadCount);
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = 0;
+    cout << "\n-----Results-----\n";
+    for (size_t i = 0; i < blobs.size(); i++) {
+        for (uint32_t entry : matches[i]) {
+            cout << blobs[i].path(entry) << '\n';
+        }
+        count += matches[i].size();
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << count << " matches, load: " << chrono::duration_cast<chrono::microseconds>(scanBegin - begin).count() / 1000.0
+             << " ms, scan: " << chrono::duration_cast<chrono::microseconds>(end - scanBegin).count() / 1000.0 << " ms on "
+             << threadCount << " threads" << endl;
+    }
+    if (bench) {
+        begin = chrono::steady_clock::now();
+        vector<DirRef> scopes = {};
+        vector<yyjson_doc*> docs = loadScopes(files, searchDir, scopes);
+        chrono::steady_clock::time_point walkBegin = chrono::steady_clock::now();
+        vector<string> baseline = trieSubstringSearch(scopes, query);
+        end = chrono::steady_clock::now();
+        cerr << "Trie walk: " << baseline.size() << " matches, load: " << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0
+             << " ms, walk: " << chrono::duration_cast<chrono::microseconds>(end - walkBegin).count() / 1000.0 << " ms" << endl;
+        for (auto doc : docs) {
+            yyjson_doc_free(doc);
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+int batch(const vector<string> &files, const string &searchDir, const string &batchFile, bool bench, bool printStats) {
+    vector<string> queries = {};
+    ifstream queryFile;
+    if (batchFile != "-") {
+        queryFile.open(batchFile);
+        if (!queryFile.is_open()) {
+            cerr << "Failed to open query file " << batchFile << endl;
+            return 1;
+        }
+    }
+    istream &in = batchFile == "-" ? cin : queryFile;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            queries.push_back(line);
+        }
+    }
+
+    // every shard is loaded and walked once for all the queries
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<DirRef> scopes = {};
+    vector<yyjson_doc*> docs = loadScopes(files, searchDir, scopes);
+    if (scopes.empty()) {
+        cout << "Directory " << searchDir << " not found or not indexed!" << endl;
+        return 1;
+    }
+    chrono::steady_clock::time_point walkBegin = chrono::steady_clock::now();
+    BatchSearch search(queries);
+    BatchResult result = search.run(scopes);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    // every result is tagged with the query it answers, in the order the queries were given
+    cout << "\n-----Results-----\n";
+    size_t count = 0;
+    for (const auto &query : queries) {
+        for (const auto &path : result.matches[search.indexOf(query)]) {
+            cout << query << '\t' << path << '\n';
+            count++;
+        }
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << queries.size() << " queries, " << count << " results, nodes visited: " << result.nodesVisited
+             << ", load: " << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0
+             << " ms, walk: " << chrono::duration_cast<chrono::microseconds>(end - walkBegin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench) {
+        // the same queries one at a time over the loaded index, without the reload a separate run would pay
+        size_t visited = 0;
+        begin = chrono::steady_clock::now();
+        for (const auto &key : search.queryKeys()) {
+            visited += BatchSearch({key}).run(scopes).nodesVisited;
+        }
+        end = chrono::steady_clock::now();
+        cerr << "One at a time: nodes visited: " << visited << ", walk: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+
+    for (auto doc : docs) {
+        yyjson_doc_free(doc);
+    }
+    return 0;
+}
+
+int glob(const string &searchDir, const string &pattern, bool bench, bool printStats) {
+    Glob compiled(pattern);
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    // the extension indexes are only needed when the pattern ends in a literal extension
+    vector<DirRef> fileScopes = {}, extensionScopes = {};
+    vector<yyjson_doc*> docs = loadScopes(indexFilesFor(searchDir, "file"), searchDir, fileScopes);
+    if (compiled.usesExtension()) {
+        vector<yyjson_doc*> extensionDocs = loadScopes(indexFilesFor(searchDir, "ext"), searchDir, extensionScopes);
+        docs.insert(docs.end(), extensionDocs.begin(), extensionDocs.end());
+    }
+    if (fileScopes.empty() && extensionScopes.empty()) {
+        cout << "Directory " << searchDir << " not found or not indexed!" << endl;
+        return 1;
+    }
+    chrono::steady_clock::time_point walkBegin = chrono::steady_clock::now();
+    size_t visited = 0;
+    vector<string> matches = globSearch(compiled, fileScopes, extensionScopes, visited);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    cout << "\n-----Results-----\n";
+    for (const auto &each : matches) {
+        cout << each << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << matches.size() << " matches, nodes visited: " << visited << ", load: "
+             << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0 << " ms, walk: "
+             << chrono::duration_cast<chrono::microseconds>(end - walkBegin).count() / 1000.0 << " ms ("
+             << (compiled.usesExtension() ? "extension " + compiled.extensionKey() : "prefix " + compiled.prefixKey()) << ")" << endl;
+    }
+    if (bench) {
+        begin = chrono::steady_clock::now();
+        vector<string> baseline = naiveGlob(compiled, fileScopes);
+        end = chrono::steady_clock::now();
+        cerr << "Every name: " << baseline.size() << " matches, walk: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+
+    for (auto doc : docs) {
+        yyjson_doc_free(doc);
+    }
+    return 0;
+}
+
+int regexMode(const vector<string> &files, const string &searchDir, const string &pattern, bool bench, bool printStats) {
+    Regex regex(pattern);
+    if (!regex.valid()) {
+        cerr << "Invalid regex: " << regex.errorMessage() << endl;
+        return 1;
+    }
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<NameBlob> blobs(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!readNameBlob(sidecarPath(files[i], "names"), blobs[i])) {
+            cerr << "No name blob for " << files[i] << ", run the indexer again" << endl;
+        }
+    }
+    chrono::steady_clock::time_point searchBegin = chrono::steady_clock::now();
+
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    RegexStats stats;
+    vector<vector<uint32_t>> matches(blobs.size());
+    for (size_t i = 0; i < blobs.size(); i++) {
+        matches[i] = regexSearch(regex, blobs[i], searchDir, threadCount, stats);
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = 0;
+    cout << "\n-----Results-----\n";
+    for (size_t i = 0; i < blobs.size(); i++) {
+        for (uint32_t entry : matches[i]) {
+            cout << blobs[i].path(entry) << '\n';
+        }
+        count += matches[i].size();
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << count << " matches, literal: \"" << stats.literal << "\", candidates: " << stats.candidates
+             << ", dfa states: " << regex.dfaStates() << ", load: "
+             << chrono::duration_cast<chrono::microseconds>(searchBegin - begin).count() / 1000.0 << " ms, search: "
+             << chrono::duration_cast<chrono::microseconds>(end - searchBegin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench) {
+        size_t baseline = 0;
+        begin = chrono::steady_clock::now();
+        for (const auto &blob : blobs) {
+            baseline += regexEveryPath(regex, blob, searchDir).size();
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Every path: " << baseline << " matches, search: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    return 0;
+}
+
+int metadata(const vector<string> &files, const string &searchDir, const string &userSearch, const MetaFilter &filter, bool regexTerm, const string &grepText, bool bench, bool printStats) {
+    // the term narrows the names further: a glob on the name, a regex on the full path, otherwise a substring of the name
+    bool globTerm = !regexTerm && Glob::isGlob(userSearch);
+    Glob glob(userSearch);
+    Regex regex(regexTerm ? userSearch : "");
+    if (regexTerm && !regex.valid()) {
+        cerr << "Invalid regex: " << regex.errorMessage() << endl;
+        return 1;
+    }
+    string query = userSearch;
+    transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    auto nameMatches = [&](const NameBlob &blob, uint32_t entry) {
+        const NameEntry &each = blob.entries[entry];
+        if (globTerm) {
+            return glob.matches(blob.names.data() + each.offset, each.length);
+        }
+        if (regexTerm) {
+            string path = blob.path(entry);
+            return regex.search(path.data(), path.size());
+        }
+        return simdFind(blob.lower.data() + each.offset, each.length, query) != nullptr;
+    };
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<NameBlob> blobs(files.size());
+    vector<unique_ptr<MappedFile>> mapped;
+    vector<ColumnView> columns(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        mapped.push_back(make_unique<MappedFile>(sidecarPath(files[i], "columns")));
+        if (!readNameBlob(sidecarPath(files[i], "names"), blobs[i]) || !columns[i].open(*mapped[i]) || columns[i].count != blobs[i].entries.size()) {
+            cerr << "No metadata columns for " << files[i] << ", run the indexer again" << endl;
+            columns[i] = ColumnView();
+        }
+    }
+    chrono::steady_clock::time_point filterBegin = chrono::steady_clock::now();
+
+    // the predicates go first over whole columns, the names are only looked at for the rows they keep
+    size_t selected = 0;
+    vector<vector<char>> inScope(blobs.size());
+    vector<vector<uint32_t>> matches(blobs.size());
+    for (size_t i = 0; i < blobs.size(); i++) {
+        const NameBlob &blob = blobs[i];
+        inScope[i] = blob.dirsBelow(searchDir);
+        vector<uint32_t> rows = selectRows(columns[i], filter);
+        selected += rows.size();
+        for (uint32_t row : rows) {
+            if (inScope[i][blob.entries[row].dir] && nameMatches(blob, row)) {
+                matches[i].push_back(row);
+            }
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    if (!grepText.empty()) {
+        vector<string> paths;
+        for (size_t i = 0; i < blobs.size(); i++) {
+            for (uint32_t entry : matches[i]) {
+                paths.push_back(blobs[i].path(entry));
+            }
+        }
+        if (printStats) {
+            cerr << paths.size() << " files selected in " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+        }
+        return grep(paths, grepText, bench, printStats);
+    }
+
+    size_t count = 0;
+    cout << "\n-----Results-----\n";
+    for (size_t i = 0; i < blobs.size(); i++) {
+        for (uint32_t entry : matches[i]) {
+            cout << blobs[i].path(entry) << '\n';
+        }
+        count += matches[i].size();
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << count << " matches, " << selected << " rows passed the metadata filter, load: "
+             << chrono::duration_cast<chrono::microseconds>(filterBegin - begin).count() / 1000.0 << " ms, filter: "
+             << chrono::duration_cast<chrono::microseconds>(end - filterBegin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench) {
+        // what answering it without the columns costs: match the names, then ask the filesystem about each of them
+        size_t baseline = 0, statted = 0;
+        begin = chrono::steady_clock::now();
+        for (size_t i = 0; i < blobs.size(); i++) {
+            const NameBlob &blob = blobs[i];
+            for (size_t entry = 0; entry < blob.entries.size(); entry++) {
+                if (!inScope[i][blob.entries[entry].dir] || !nameMatches(blob, static_cast<uint32_t>(entry))) {
+                    continue;
+                }
+                error_code ec;
+                fs::directory_entry onDisk(blob.path(entry), ec);
+                statted++;
+                if (!ec && filter.keeps(fileMeta(onDisk))) {
+                    baseline++;
+                }
+            }
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Filesystem: " << baseline << " matches, " << statted << " paths statted, search: "
+             << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    return 0;
+}
+
+int largest(const vector<string> &files, const string &searchDir, size_t n, bool bench, bool printStats) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    unordered_map<string, DirUsage> usage;
+    unordered_map<string, size_t> shardOf;
+    for (size_t i = 0; i < files.size(); i++) {
+        vector<UsageRow> rows;
+        if (!readUsageTable(sidecarPath(files[i], "usage"), rows)) {
+            cerr << "No disk usage for " << files[i] << ", run the indexer again" << endl;
+            continue;
+        }
+        for (const auto &[key, each] : rows) {
+            usage[key].add(each);
+            shardOf[key] = i;
+        }
+    }
+    // every shard is rolled up up to its top directory, the tops are added to their parent in the other shard
+    vector<string> keys;
+    for (const auto &each : usage) {
+        keys.push_back(each.first);
+    }
+    sort(keys.begin(), keys.end(), [](const string &a, const string &b) { return a.size() > b.size(); });
+    for (const auto &key : keys) {
+        auto parent = usage.find(parentKey(key));
+        if (parent != usage.end() && shardOf[parent->first] != shardOf[key]) {
+            parent->second.add(usage[key]);
+        }
+    }
+    vector<UsageRow> top = largestDirectories(usage, searchDir, n);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    cout << "\n-----Results-----\n";
+    auto it = usage.find(searchDir);
+    if (it != usage.end()) {
+        cout << it->second.bytes << " bytes, " << it->second.files << " files, " << it->second.dirs << " directories in " << searchDir << '\n';
+    }
+    for (const auto &[key, each] : top) {
+        cout << each.bytes << '\t' << each.files << '\t' << each.dirs << '\t' << key << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << usage.size() << " directories, query: " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    if (bench) {
+        // what the separate du pass costs: walk the directory again and sum every file into its ancestors
+        begin = chrono::steady_clock::now();
+        unordered_map<string, DirUsage> walked;
+        error_code ec;
+        for (auto entry = fs::recursive_directory_iterator(searchDir, fs::directory_options::skip_permission_denied, ec);
+             !ec && entry != fs::recursive_directory_iterator(); entry.increment(ec)) {
+            string key = entry->path().parent_path().string();
+            replace(key.begin(), key.end(), '\\', '/');
+            key += '/';
+            DirUsage direct;
+            if (entry->is_symlink(ec) || !entry->is_directory(ec)) {
+                direct.files = 1;
+                if (!entry->is_symlink(ec) && entry->is_regular_file(ec)) {
+                    uintmax_t size = entry->file_size(ec);
+                    direct.bytes = ec ? 0 : size;
+                }
+            } else {
+                direct.dirs = 1;
+                string dirKey = entry->path().string();
+                replace(dirKey.begin(), dirKey.end(), '\\', '/');
+                walked[dirKey + '/'];
+            }
+            for (; key.size() > searchDir.size(); key = parentKey(key)) {
+                walked[key].add(direct);
+            }
+            ec.clear();
+        }
+        vector<UsageRow> walkedTop = largestDirectories(walked, searchDir, n);
+        end = chrono::steady_clock::now();
+        bool same = walkedTop.size() == top.size();
+        for (size_t i = 0; same && i < top.size(); i++) {
+            same = walkedTop[i].first == top[i].first && walkedTop[i].second.bytes == top[i].second.bytes;
+        }
+        cerr << "Filesystem walk: " << walked.size() << " directories, " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0
+             << " ms, " << (same ? "same" : "different") << " result" << endl;
+    }
+    return 0;
+}
+
+int duplicates(const vector<string> &files, const string &searchDir, const MetaFilter &filter, bool bench, bool printStats) {
+    // the regular files below the directory with their indexed size
+    MetaFilter regular = filter;
+    regular.type = TYPE_FILE;
+    vector<DupFile> candidates;
+    for (const auto &file : files) {
+        NameBlob blob;
+        MappedFile mapped(sidecarPath(file, "columns"));
+        ColumnView columns;
+        if (!readNameBlob(sidecarPath(file, "names"), blob) || !columns.open(mapped) || columns.count != blob.entries.size()) {
+            cerr << "No metadata columns for " << file << ", run the indexer again" << endl;
+            continue;
+        }
+        vector<char> inScope = blob.dirsBelow(searchDir);
+        for (uint32_t row : selectRows(columns, regular)) {
+            if (inScope[blob.entries[row].dir]) {
+                candidates.push_back({blob.path(row), columns.size[row]});
+            }
+        }
+    }
+
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    DupStats stats;
+    vector<vector<size_t>> groups = findDuplicates(candidates, threadCount, stats);
+
+    uint64_t wasted = 0;
+    cout << "\n-----Results-----\n";
+    for (const auto &group : groups) {
+        cout << candidates[group[0]].size << " bytes x " << group.size() << '\n';
+        for (size_t each : group) {
+            cout << "  " << candidates[each].path << '\n';
+        }
+        wasted += candidates[group[0]].size * (group.size() - 1);
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        double megabytes = stats.bytesRead / 1048576.0;
+        cerr << groups.size() << " duplicate groups, " << wasted << " bytes in extra copies" << endl;
+        cerr << candidates.size() << " files, " << stats.sizeCandidates << " share a size, " << stats.hardLinks << " of them extra hard links, "
+             << stats.edgeCandidates << " hashed whole" << endl;
+        cerr << "Read " << stats.bytesRead << " of " << stats.totalBytes << " bytes ("
+             << (stats.totalBytes ? 100.0 * stats.bytesRead / stats.totalBytes : 0.0) << "%) in " << stats.hashSeconds * 1000 << " ms, "
+             << (stats.hashSeconds > 0 ? megabytes / stats.hashSeconds / stats.threads : 0.0) << " MB/s per core on " << stats.threads << " threads" << endl;
+    }
+    if (bench) {
+        // every file hashed whole once, grouped by size and hash
+        vector<FileId> ids;
+        vector<char> ok;
+        uint64_t bytesRead = 0;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        vector<size_t> all(candidates.size());
+        for (size_t i = 0; i < all.size(); i++) {
+            all[i] = i;
+        }
+        hashInParallel(candidates, all, readFileId, threadCount, ids, ok, bytesRead);
+        set<FileId> seen;
+        vector<size_t> every;
+        for (size_t i = 0; i < all.size(); i++) {
+            if (!ok[i] || seen.insert(ids[i]).second) {
+                every.push_back(i);
+            }
+        }
+        vector<uint64_t> hashes;
+        hashInParallel(candidates, every, hashWhole, threadCount, hashes, ok, bytesRead);
+        map<pair<uint64_t, uint64_t>, size_t> byContent;
+        for (size_t i = 0; i < every.size(); i++) {
+            if (ok[i] && candidates[every[i]].size > 0) {
+                byContent[{candidates[every[i]].size, hashes[i]}]++;
+            }
+        }
+        size_t baselineGroups = 0;
+        for (const auto &each : byContent) {
+            baselineGroups += each.second > 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cerr << "Hash everything: " << baselineGroups << " duplicate groups, read " << bytesRead << " bytes in " << seconds * 1000 << " ms" << endl;
+    }
+    return 0;
+}
+
+int grep(const vector<string> &paths, const string &text, bool bench, bool printStats) {
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    cout << "\n-----Results-----\n";
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    GrepStats stats = grepFiles(paths, text, threadCount, cout);
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(end - begin).count();
+
+    if (printStats || bench) {
+        cerr << stats.lines << " matching lines in " << stats.matchingFiles << " of " << stats.files << " files, " << stats.bytes << " bytes in "
+             << seconds * 1000 << " ms (" << (seconds > 0 ? stats.bytes / 1048576.0 / seconds : 0.0) << " MB/s) on " << stats.threads << " threads" << endl;
+    }
+    if (bench) {
+        string found;
+        begin = chrono::steady_clock::now();
+        size_t lines = naiveGrep(paths, text, found);
+        end = chrono::steady_clock::now();
+        seconds = chrono::duration<double>(end - begin).count();
+        cerr << "ifstream + find: " << lines << " matching lines in " << seconds * 1000 << " ms (" << (seconds > 0 ? stats.bytes / 1048576.0 / seconds : 0.0)
+             << " MB/s)" << endl;
+    }
+    return stats.lines > 0 ? 0 : 1;
+}
+
+int listPaths(const vector<string> &files, const string &searchDir, bool bench, bool printStats) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<unique_ptr<MappedFile>> mapped;
+    vector<PathDictionary> dictionaries;
+    uint64_t dictionaryBytes = 0, indexBytes = 0;
+    for (const auto &file : files) {
+        mapped.push_back(make_unique<MappedFile>(sidecarPath(file, "paths")));
+        PathDictionary dictionary;
+        if (!dictionary.open(mapped.back()->data(), mapped.back()->size())) {
+            cerr << "No path dictionary for " << file << ", run the indexer again" << endl;
+            continue;
+        }
+        dictionaries.push_back(dictionary);
+        dictionaryBytes += mapped.back()->size();
+        error_code ec;
+        uint64_t size = fs::file_size(file, ec);
+        indexBytes += ec ? 0 : size;
+    }
+
+    // the paths of a shard below searchDir are one sorted run, the runs of the shards are merged
+    vector<string> paths;
+    for (const auto &dictionary : dictionaries) {
+        size_t runStart = paths.size();
+        dictionary.forEachFrom(dictionary.lowerBound(searchDir), [&](const string &path) {
+            if (path.compare(0, searchDir.size(), searchDir) != 0) {
+                return false;
+            }
+            paths.push_back(path);
+            return true;
+        });
+        inplace_merge(paths.begin(), paths.begin() + runStart, paths.end());
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = paths.size();
+    cout << "\n-----Results-----\n";
+    for (const auto &path : paths) {
+        cout << path << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        uint64_t pathCount = 0, pathBytes = 0;
+        for (const auto &dictionary : dictionaries) {
+            pathCount += dictionary.size();
+            dictionary.forEachFrom(0, [&](const string &path) {
+                pathBytes += path.size() + 1;
+                return true;
+            });
+        }
+        cerr << count << " paths listed in " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+        cerr << pathCount << " paths, dictionary: " << dictionaryBytes << " bytes, plain paths: " << pathBytes << " bytes ("
+             << (dictionaryBytes ? static_cast<double>(pathBytes) / dictionaryBytes : 0.0) << "x), file index json: " << indexBytes << " bytes ("
+             << (dictionaryBytes ? static_cast<double>(indexBytes) / dictionaryBytes : 0.0) << "x)" << endl;
+    }
+    if (bench) {
+        // exact lookups of paths that are there and of paths that are not, spread over the whole dictionary
+        const size_t LOOKUPS = 100000;
+        for (const auto &dictionary : dictionaries) {
+            if (dictionary.size() == 0) {
+                continue;
+            }
+            vector<string> keys;
+            uint64_t state = 88172645463325252ull;
+            for (size_t i = 0; i < LOOKUPS / dictionaries.size() + 1; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                keys.push_back(dictionary.at(state % dictionary.size()));
+            }
+            size_t hits = 0, falseHits = 0;
+            begin = chrono::steady_clock::now();
+            for (const auto &key : keys) {
+                hits += dictionary.contains(key);
+            }
+            chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+            for (const auto &key : keys) {
+                falseHits += dictionary.contains(key + '\x01');
+            }
+            end = chrono::steady_clock::now();
+            cerr << "Lookup in " << dictionary.size() << " paths: " << hits << "/" << keys.size() << " found, "
+                 << chrono::duration<double, nano>(middle - begin).count() / keys.size() << " ns per hit, "
+                 << chrono::duration<double, nano>(end - middle).count() / keys.size() << " ns per miss (" << falseHits << " false)" << endl;
+        }
+    }
+    return 0;
+}
+
+int succinct(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    string query = trieKeyOf(userSearch);
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<LoudsTrie> tries;
+    // the name blobs are mapped like the tries, only the entries and names of the matches are read
+    vector<NameBlobView> blobs;
+    vector<unique_ptr<MappedFile>> nameMaps;
+    vector<unique_ptr<MappedFile>> mapped = openSidecars(files, "louds", "succinct trie", [&](const string &file, const MappedFile &map) {
+        LoudsTrie trie;
+        NameBlobView blob;
+        auto names = make_unique<MappedFile>(sidecarPath(file, "names"));
+        if (!trie.open(map.data(), map.size()) || !blob.open(names->data(), names->size())) {
+            return false;
+        }
+        tries.push_back(trie);
+        blobs.push_back(blob);
+        nameMaps.push_back(move(names));
+        return true;
+    });
+    if (tries.empty()) {
+        return 1;
+    }
+    chrono::steady_clock::time_point walkBegin = chrono::steady_clock::now();
+
+    vector<vector<uint32_t>> matches(tries.size());
+    for (size_t i = 0; i < tries.size(); i++) {
+        int64_t node = tries[i].find(query);
+        if (node < 0) {
+            continue;
+        }
+        tries[i].forEachValue(node, [&](uint32_t entry) {
+            if (blobs[i].dirBelow(blobs[i].entry(entry).dir, searchDir)) {
+                matches[i].push_back(entry);
+            }
+        });
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = 0;
+    cout << "\n-----Results-----\n";
+    for (size_t i = 0; i < tries.size(); i++) {
+        for (uint32_t entry : matches[i]) {
+            cout << blobs[i].path(entry) << '\n';
+        }
+        count += matches[i].size();
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        uint64_t nodes = 0, keys = 0;
+        double bits = 0;
+        for (const auto &trie : tries) {
+            nodes += trie.nodes();
+            keys += trie.keys();
+            bits += trie.bitsPerNode() * trie.nodes();
+        }
+        cerr << count << " matches, load: " << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0
+             << " ms, walk: " << chrono::duration_cast<chrono::microseconds>(end - walkBegin).count() / 1000.0 << " ms" << endl;
+        cerr << "Succinct tries: " << nodes << " nodes for " << keys << " keys, " << (nodes ? bits / nodes : 0.0) << " bits per node" << endl;
+    }
+    if (bench) {
+        begin = chrono::steady_clock::now();
+        vector<DirRef> scopes = {};
+        vector<yyjson_doc*> docs = loadScopes(files, searchDir, scopes);
+        walkBegin = chrono::steady_clock::now();
+        BatchResult baseline = BatchSearch({query}).run(scopes);
+        end = chrono::steady_clock::now();
+        cerr << "Json tries: " << baseline.matches[0].size() << " matches, load: " << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0
+             << " ms, walk: " << chrono::duration_cast<chrono::microseconds>(end - walkBegin).count() / 1000.0 << " ms" << endl;
+
+        // size of the json file index against the character nodes it holds
+        uint64_t jsonNodes = 0, jsonBytes = 0;
+        for (size_t i = 0; i < docs.size(); i++) {
+            jsonNodes += countTrieNodes(yyjson_doc_get_root(docs[i]));
+        }
+        for (const auto &file : files) {
+            error_code ec;
+            uint64_t size = fs::file_size(file, ec);
+            jsonBytes += ec ? 0 : size;
+        }
+        cerr << "Json tries: " << jsonNodes << " nodes, " << (jsonNodes ? 8.0 * jsonBytes / jsonNodes : 0.0) << " bits per node of the file index" << endl;
+
+        // every two character prefix, enumerated in both
+        vector<string> prefixes;
+        const string alphabet = "abcdefghijklmnopqrstuvwxyz0123456789";
+        for (char a : alphabet) {
+            for (char b : alphabet) {
+                prefixes.push_back(string(1, a) + b);
+            }
+        }
+        size_t loudsCount = 0, jsonCount = 0;
+        begin = chrono::steady_clock::now();
+        for (const auto &prefix : prefixes) {
+            for (size_t i = 0; i < tries.size(); i++) {
+                int64_t node = tries[i].find(prefix);
+                if (node >= 0) {
+                    tries[i].forEachValue(node, [&](uint32_t entry) { loudsCount += blobs[i].dirBelow(blobs[i].entry(entry).dir, searchDir); });
+                }
+            }
+        }
+        chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+        for (const auto &prefix : prefixes) {
+            BatchResult each = BatchSearch({prefix}).run(scopes);
+            jsonCount += each.matches[0].size();
+        }
+        end = chrono::steady_clock::now();
+        cerr << prefixes.size() << " two character prefixes: succinct " << loudsCount << " matches in "
+             << chrono::duration_cast<chrono::microseconds>(middle - begin).count() / 1000.0 << " ms, json " << jsonCount << " matches in "
+             << chrono::duration_cast<chrono::microseconds>(end - middle).count() / 1000.0 << " ms" << endl;
+        for (auto doc : docs) {
+            yyjson_doc_free(doc);
+        }
+    }
+    return 0;
+}
+
+// character nodes of every directory trie below node
+size_t countTrieNodes(yyjson_val *node) {
+    size_t count = 0;
+    size_t index, max;
+    yyjson_val *key, *value;
+    yyjson_obj_foreach(node, index, max, key, value) {
+        if (!yyjson_is_obj(value)) {
+            continue;
+        }
+        count += isTrieKey(key);
+        count += countTrieNodes(value);
+    }
+    return count;
+}
+
+int dagSearch(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    string query = userSearch;
+    transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<DagIndex> dags;
+    uint64_t dagBytes = 0;
+    vector<unique_ptr<MappedFile>> mapped = openSidecars(files, "dag", "shared subtree index", [&](const string &, const MappedFile &map) {
+        DagIndex dag;
+        if (!dag.open(map.data(), map.size())) {
+            return false;
+        }
+        dags.push_back(dag);
+        dagBytes += map.size();
+        return true;
+    });
+    if (dags.empty()) {
+        return 1;
+    }
+
+    vector<string> paths;
+    string lower;
+    auto contains = [&](const string &name) {
+        lower.resize(name.size());
+        transform(name.begin(), name.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return lower.find(query) != string::npos;
+    };
+    for (const auto &dag : dags) {
+        dag.forEachMatch(searchDir, contains, [&](const string &path) { paths.push_back(path); });
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = paths.size();
+    cout << "\n-----Results-----\n";
+    for (const auto &path : paths) {
+        cout << path << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        uint64_t nodes = 0, dirs = 0, blobBytes = 0, indexBytes = 0;
+        for (const auto &dag : dags) {
+            nodes += dag.nodes();
+            dirs += dag.concreteDirs();
+        }
+        for (const auto &file : files) {
+            error_code ec;
+            uint64_t size = fs::file_size(sidecarPath(file, "names"), ec);
+            blobBytes += ec ? 0 : size;
+            size = fs::file_size(file, ec);
+            indexBytes += ec ? 0 : size;
+        }
+        cerr << count << " matches in " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+        cerr << dirs << " directories stored as " << nodes << " nodes, dag: " << dagBytes << " bytes, name blob: " << blobBytes << " bytes ("
+             << (dagBytes ? static_cast<double>(blobBytes) / dagBytes : 0.0) << "x), file index json: " << indexBytes << " bytes ("
+             << (dagBytes ? static_cast<double>(indexBytes) / dagBytes : 0.0) << "x)" << endl;
+    }
+    if (bench) {
+        // the same search over the flat name blobs, every copy stored and scanned
+        paths.clear();
+        begin = chrono::steady_clock::now();
+        size_t baseline = 0;
+        for (const auto &file : files) {
+            NameBlob blob;
+            if (readNameBlob(sidecarPath(file, "names"), blob)) {
+                for (uint32_t entry : scanNames(blob, searchDir, query, max(1u, thread::hardware_concurrency()))) {
+                    paths.push_back(blob.path(entry));
+                    baseline++;
+                }
+            }
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Name blob scan: " << baseline << " matches in " << chrono::duration_cast<chrono::microseconds>(end - begin).count() / 1000.0 << " ms" << endl;
+    }
+    return 0;
+}
+
+int exact(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<ExactNames> tables;
+    vector<string> tableFiles;
+    vector<unique_ptr<MappedFile>> mapped = openSidecars(files, "exact", "exact name table", [&](const string &file, const MappedFile &map) {
+        ExactNames table;
+        if (!table.open(map.data(), map.size())) {
+            return false;
+        }
+        tables.push_back(table);
+        tableFiles.push_back(file);
+        return true;
+    });
+    if (tables.empty()) {
+        return 1;
+    }
+    // the lookup is timed up to the paths, only the shards with a hit map their names to turn the entries into paths
+    chrono::steady_clock::time_point lookupBegin = chrono::steady_clock::now();
+    vector<string> paths;
+    for (size_t i = 0; i < tables.size(); i++) {
+        auto found = tables[i].find(userSearch);
+        if (found.first == found.second) {
+            continue;
+        }
+        MappedFile names(sidecarPath(tableFiles[i], "names"));
+        NameBlobView blob;
+        if (!blob.open(names.data(), names.size())) {
+            continue;
+        }
+        for (const uint32_t *entry = found.first; entry != found.second; entry++) {
+            if (blob.dirBelow(blob.entry(*entry).dir, searchDir)) {
+                paths.push_back(blob.path(*entry));
+            }
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = paths.size();
+    cout << "\n-----Results-----\n";
+    for (const auto &path : paths) {
+        cout << path << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        size_t names = 0;
+        for (const auto &table : tables) {
+            names += table.names();
+        }
+        cerr << count << " matches, " << names << " distinct names, open: " << chrono::duration_cast<chrono::microseconds>(lookupBegin - begin).count() / 1000.0
+             << " ms, lookup to paths: " << chrono::duration<double, micro>(end - lookupBegin).count() << " us" << endl;
+    }
+    if (bench) {
+        // lookups of names that are there and of names that are not, spread over every shard
+        const size_t LOOKUPS = 100000;
+        vector<string> keys;
+        uint64_t state = 88172645463325252ull;
+        for (size_t i = 0; i < LOOKUPS; i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const ExactNames &table = tables[state % tables.size()];
+            if (table.names() > 0) {
+                keys.push_back(table.name((state >> 20) % table.names()));
+            }
+        }
+        size_t hits = 0, falseHits = 0;
+        begin = chrono::steady_clock::now();
+        for (const auto &key : keys) {
+            for (const auto &table : tables) {
+                auto each = table.find(key);
+                hits += each.first != each.second;
+            }
+        }
+        chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+        for (const auto &key : keys) {
+            for (const auto &table : tables) {
+                auto each = table.find(key + '\x01');
+                falseHits += each.first != each.second;
+            }
+        }
+        end = chrono::steady_clock::now();
+        cerr << keys.size() << " names looked up in " << tables.size() << " shards: " << hits << " shard hits, "
+             << chrono::duration<double, nano>(middle - begin).count() / keys.size() << " ns per name, "
+             << chrono::duration<double, nano>(end - middle).count() / keys.size() << " ns per missing name (" << falseHits << " false)" << endl;
+
+        // the trie walk: the names starting with the stem, kept when the whole name is equal
+        begin = chrono::steady_clock::now();
+        vector<DirRef> scopes = {};
+        vector<yyjson_doc*> docs = loadScopes(files, searchDir, scopes);
+        chrono::steady_clock::time_point walkBegin = chrono::steady_clock::now();
+        string stem = fs::path(userSearch).stem().string();
+        BatchResult walked = BatchSearch({stem}).run(scopes);
+        string wanted = lowerName(userSearch);
+        size_t baseline = 0;
+        for (const auto &path : walked.matches[0]) {
+            baseline += lowerName(path.substr(path.find_last_of('/') + 1)) == wanted;
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Trie walk: " << baseline << " matches, nodes visited: " << walked.nodesVisited << ", load: "
+             << chrono::duration_cast<chrono::microseconds>(walkBegin - begin).count() / 1000.0
+             << " ms, walk: " << chrono::duration<double, micro>(end - walkBegin).count() << " us" << endl;
+        for (auto doc : docs) {
+            yyjson_doc_free(doc);
+        }
+    }
+    return 0;
+}
+
+int suffix(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<SuffixIndex> indexes;
+    // the name blobs are mapped like the indexes, only the entries and names of the hits are read
+    vector<NameBlobView> blobs;
+    vector<unique_ptr<MappedFile>> nameMaps;
+    vector<unique_ptr<MappedFile>> mapped = openSidecars(files, "suffix", "suffix index", [&](const string &file, const MappedFile &map) {
+        SuffixIndex index;
+        NameBlobView blob;
+        auto names = make_unique<MappedFile>(sidecarPath(file, "names"));
+        if (!index.open(map.data(), map.size()) || !blob.open(names->data(), names->size())) {
+            return false;
+        }
+        indexes.push_back(index);
+        blobs.push_back(blob);
+        nameMaps.push_back(move(names));
+        return true;
+    });
+    if (indexes.empty()) {
+        return 1;
+    }
+    chrono::steady_clock::time_point searchBegin = chrono::steady_clock::now();
+
+    vector<vector<uint32_t>> matches(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        auto range = indexes[i].endingWith(userSearch);
+        for (const uint32_t *entry = range.first; entry != range.second; entry++) {
+            if (blobs[i].dirBelow(blobs[i].entry(*entry).dir, searchDir)) {
+                matches[i].push_back(*entry);
+            }
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    size_t count = 0;
+    cout << "\n-----Results-----\n";
+    for (size_t i = 0; i < indexes.size(); i++) {
+        for (uint32_t entry : matches[i]) {
+            cout << blobs[i].path(entry) << '\n';
+        }
+        count += matches[i].size();
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        cerr << count << " matches, load: " << chrono::duration_cast<chrono::microseconds>(searchBegin - begin).count() / 1000.0
+             << " ms, search: " << chrono::duration<double, micro>(end - searchBegin).count() << " us" << endl;
+    }
+    if (bench) {
+        // every name of the name blobs compared at its end, both sides timed from opening their files
+        double indexed = chrono::duration<double, micro>(end - begin).count();
+        string query = userSearch;
+        transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        size_t baseline = 0;
+        begin = chrono::steady_clock::now();
+        for (const auto &file : files) {
+            NameBlob blob;
+            if (!readNameBlob(sidecarPath(file, "names"), blob)) {
+                continue;
+            }
+            vector<char> inScope = blob.dirsBelow(searchDir);
+            for (const auto &entry : blob.entries) {
+                if (entry.length >= query.size() && blob.lower.compare(entry.offset + entry.length - query.size(), query.size(), query) == 0 &&
+                    inScope[entry.dir]) {
+                    baseline++;
+                }
+            }
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Full scan: " << baseline << " matches, load and search: " << chrono::duration<double, micro>(end - begin).count()
+             << " us, suffix index load and search: " << indexed << " us" << endl;
+    }
+    return 0;
+}
+
+int directories(const vector<string> &files, const string &searchDir, const string &userSearch, bool bench, bool printStats) {
+    string query = userSearch;
+    transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    vector<DirIndex> indexes;
+    uint64_t indexBytes = 0;
+    vector<unique_ptr<MappedFile>> mapped = openSidecars(files, "dirs", "directory index", [&](const string &, const MappedFile &map) {
+        DirIndex index;
+        if (!index.open(map.data(), map.size())) {
+            return false;
+        }
+        indexes.push_back(index);
+        indexBytes += map.size();
+        return true;
+    });
+    if (indexes.empty()) {
+        return 1;
+    }
+    chrono::steady_clock::time_point searchBegin = chrono::steady_clock::now();
+
+    vector<string> paths;
+    for (const auto &index : indexes) {
+        for (uint32_t id : index.search(searchDir, query)) {
+            paths.push_back(index.path(id));
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+    cout << "\n-----Results-----\n";
+    for (const auto &path : paths) {
+        cout << path << '\n';
+    }
+    cout.flush();
+
+    if (printStats || bench) {
+        size_t dirs = 0;
+        for (const auto &index : indexes) {
+            dirs += index.size();
+        }
+        cerr << paths.size() << " directories, open: " << chrono::duration<double, micro>(searchBegin - begin).count()
+             << " us, search: " << chrono::duration<double, micro>(end - searchBegin).count() << " us" << endl;
+        cerr << dirs << " directories indexed in " << indexBytes << " bytes" << endl;
+    }
+    if (bench) {
+        // what --type d does: every name scanned, the directories kept by the type column
+        begin = chrono::steady_clock::now();
+        size_t baseline = 0;
+        uint64_t fileBytes = 0;
+        for (const auto &file : files) {
+            NameBlob blob;
+            MappedFile columnFile(sidecarPath(file, "columns"));
+            ColumnView columns;
+            if (!readNameBlob(sidecarPath(file, "names"), blob) || !columns.open(columnFile) || columns.count != blob.entries.size()) {
+                continue;
+            }
+            fileBytes += blob.dirs.size() + blob.names.size() + blob.lower.size() + columnFile.size();
+            for (uint32_t entry : scanNames(blob, searchDir, query, max(1u, thread::hardware_concurrency()))) {
+                baseline += columns.type[entry] == TYPE_DIRECTORY;
+            }
+        }
+        end = chrono::steady_clock::now();
+        cerr << "Name blob scan with the type column: " << baseline << " directories, " << fileBytes << " bytes read, "
+             << chrono::duration<double, micro>(end - begin).count() << " us" << endl;
+    }
+    return 0;
+}
+
+// maps the kind sidecar of every file, open reads one and the maps it keeps stay alive as long as the result
+vector<unique_ptr<MappedFile>> openSidecars(const vector<string> &files, const string &kind, const string &what, const function<bool(const string&, const MappedFile&)> &open) {
+    vector<unique_ptr<MappedFile>> mapped;
+    for (const auto &file : files) {
+        auto map = make_unique<MappedFile>(sidecarPath(file, kind));
+        if (!open(file, *map)) {
+            cerr << "No " << what << " for " << file << ", run the indexer again" << endl;
+            continue;
+        }
+        mapped.push_back(move(map));
+    }
+    return mapped;
+}
+
+void printUsage() {
+    cerr << "Usage: file_searcher <directory_path> <search_term> [--stream] [--stats] [--bench] [--rank K] [--words] [--scan] [--louds] [--dag] [--exact] [--suffix] [--dirs] [--regex] [--complete K [--budget-us N] [--interactive]] [--fuzzy D]" << endl;
+    cerr << "                     [--min-size S] [--max-size S] [--newer AGE] [--older AGE] [--type f|d|l] [--grep TEXT]" << endl;
+    cerr << "       file_searcher <directory_path> --batch <query_file|-> [--stats] [--bench]" << endl;
+    cerr << "       file_searcher <directory_path> --largest N [--stats] [--bench]" << endl;
+    cerr << "       file_searcher <directory_path> --paths [--stats] [--bench]" << endl;
+    cerr << "       file_searcher <directory_path> --duplicates [--min-size S] [--max-size S] [--newer AGE] [--older AGE] [--stats] [--bench]" << endl;
+    cerr << "       file_searcher --opened <file_path>" << endl;
+}
+
+// the whole of text as a number, "12", anything else (empty, negative, trailing characters, too big) is refused
+bool parseCount(const string &text, size_t &count) {
+    size_t value = 0;
+    auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        return false;
+    }
+    count = value;
+    return true;
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the name keys of a shard as a succinct trie, next to the file index as .louds
+// the trie is stored level by level (LOUDS): every node writes its number of children in unary, "1" per child
+// and a "0" after them, so the shape takes two bits per node; the edge characters are one byte per node in the
+// same order, and one more bit per node marks the nodes a key ends at
+// with that order the children of a node are consecutive ids, and so are the descendants of a range of nodes
+// on the next level, which makes listing everything below a prefix a walk over ranges of ids instead of pointers
+// select0 on the shape finds the children of a node, rank1 on the end marks finds the names of a node
+// file layout: magic, node count, shape bits, select samples, key count, value count, then the shape words,
+// select0 samples, end mark words, end mark ranks (u32), labels, value offsets (u32, keys + 1) and the values
+// (u32 name blob entries), every array starting 8-byte aligned
+
+const char LOUDS_MAGIC[8] = {'F', 'F', 'L', 'O', 'U', 'D', 'S', '1'};
+// a rank is kept for every 512 bits and the position of every 256th zero
+const uint64_t LOUDS_RANK_BLOCK = 512;
+const uint64_t LOUDS_SELECT_SAMPLE = 256;
+
+inline int popcount64(uint64_t word) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+inline int trailingZeros64(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward64(&bit, word);
+    return static_cast<int>(bit);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+struct BitWriter {
+    std::vector<uint64_t> words;
+    uint64_t bits = 0;
+
+    void push(bool bit) {
+        if (bits % 64 == 0) {
+            words.push_back(0);
+        }
+        if (bit) {
+            words.back() |= 1ull << (bits % 64);
+        }
+        bits++;
+    }
+};
+
+// keyed holds (key, name blob entry) pairs, in any order
+inline bool writeLoudsTrie(const std::string &file, std::vector<std::pair<std::string, uint32_t>> keyed) {
+    std::sort(keyed.begin(), keyed.end());
+
+    // breadth first over ranges of the sorted keys, a range is the keys below one node
+    struct Range {
+        size_t lo, hi, depth;
+    };
+    BitWriter shape, ends;
+    std::string labels(1, '\0');  // the root has no edge character
+    std::vector<uint32_t> offsets = {0}, values;
+    shape.push(true);  // the super root above the root
+    shape.push(false);
+    std::vector<Range> level = {{0, keyed.size(), 0}};
+    while (!level.empty()) {
+        std::vector<Range> next;
+        for (const auto &node : level) {
+            // the keys that end here sort first
+            size_t lo = node.lo;
+            while (lo < node.hi && keyed[lo].first.size() == node.depth) {
+                values.push_back(keyed[lo].second);
+                lo++;
+            }
+            ends.push(lo > node.lo);
+            if (lo > node.lo) {
+                offsets.push_back(static_cast<uint32_t>(values.size()));
+            }
+            while (lo < node.hi) {
+                char c = keyed[lo].first[node.depth];
+                size_t hi = lo;
+                while (hi < node.hi && keyed[hi].first[node.depth] == c) {
+                    hi++;
+                }
+                shape.push(true);
+                labels += c;
+                next.push_back({lo, hi, node.depth + 1});
+                lo = hi;
+            }
+            shape.push(false);
+        }
+        level.swap(next);
+    }
+    uint64_t nodeCount = labels.size();
+
+    std::vector<uint64_t> samples;
+    uint64_t zeros = 0;
+    for (uint64_t i = 0; i < shape.bits; i++) {
+        if (!(shape.words[i / 64] >> (i % 64) & 1)) {
+            if (zeros % LOUDS_SELECT_SAMPLE == 0) {
+                samples.push_back(i);
+            }
+            zeros++;
+        }
+    }
+    std::vector<uint32_t> ranks;
+    uint32_t ones = 0;
+    for (size_t w = 0; w < ends.words.size(); w++) {
+        if (w % (LOUDS_RANK_BLOCK / 64) == 0) {
+            ranks.push_back(ones);
+        }
+        ones += popcount64(ends.words[w]);
+    }
+    ranks.push_back(ones);
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    auto write = [fp](const void *data, size_t bytes) {
+        static const char padding[8] = {0};
+        return fwrite(data, 1, bytes, fp) == bytes && fwrite(padding, 1, (8 - bytes % 8) % 8, fp) == (8 - bytes % 8) % 8;
+    };
+    uint64_t header[5] = {nodeCount, shape.bits, samples.size(), offsets.size() - 1, values.size()};
+    bool ok = write(LOUDS_MAGIC, sizeof(LOUDS_MAGIC)) && write(header, sizeof(header)) &&
+              write(shape.words.data(), shape.words.size() * sizeof(uint64_t)) && write(samples.data(), samples.size() * sizeof(uint64_t)) &&
+              write(ends.words.data(), ends.words.size() * sizeof(uint64_t)) && write(ranks.data(), ranks.size() * sizeof(uint32_t)) &&
+              write(labels.data(), labels.size()) && write(offsets.data(), offsets.size() * sizeof(uint32_t)) &&
+              write(values.data(), values.size() * sizeof(uint32_t));
+    return fclose(fp) == 0 && ok;
+}
+
+// read-only view of a .louds file, usually a memory mapping
+class LoudsTrie {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint64_t header[5];
+        if (fileSize < sizeof(LOUDS_MAGIC) + sizeof(header) || memcmp(file, LOUDS_MAGIC, sizeof(LOUDS_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(LOUDS_MAGIC), sizeof(header));
+        nodeCount = header[0];
+        shapeBits = header[1];
+        sampleCount = header[2];
+        keyCount = header[3];
+        valueCount = header[4];
+        size_t at = sizeof(LOUDS_MAGIC) + sizeof(header);
+        auto take = [&](size_t bytes) {
+            const char *start = file + at;
+            at += (bytes + 7) / 8 * 8;
+            return start;
+        };
+        shape = reinterpret_cast<const uint64_t *>(take((shapeBits + 63) / 64 * sizeof(uint64_t)));
+        samples = reinterpret_cast<const uint64_t *>(take(sampleCount * sizeof(uint64_t)));
+        size_t endWords = (nodeCount + 63) / 64;
+        ends = reinterpret_cast<const uint64_t *>(take(endWords * sizeof(uint64_t)));
+        ranks = reinterpret_cast<const uint32_t *>(take((endWords + LOUDS_RANK_BLOCK / 64 - 1) / (LOUDS_RANK_BLOCK / 64) * sizeof(uint32_t) + sizeof(uint32_t)));
+        labels = take(nodeCount);
+        offsets = reinterpret_cast<const uint32_t *>(take((keyCount + 1) * sizeof(uint32_t)));
+        values = reinterpret_cast<const uint32_t *>(take(valueCount * sizeof(uint32_t)));
+        return at == fileSize && nodeCount > 0;
+    }
+
+    size_t nodes() const { return nodeCount; }
+    size_t keys() const { return keyCount; }
+
+    // bits of the structure per node, without the name entries the keys point at
+    double bitsPerNode() const {
+        uint64_t endWords = (nodeCount + 63) / 64;
+        uint64_t bytes = (shapeBits + 63) / 64 * 8 + sampleCount * 8 + endWords * 8 + ((endWords + 7) / 8 + 1) * 4 + nodeCount + (keyCount + 1) * 4;
+        return nodeCount ? 8.0 * bytes / nodeCount : 0;
+    }
+
+    // node reached by walking key down from the root, -1 if the key leaves the trie
+    int64_t find(const std::string &key) const {
+        uint64_t node = 0;
+        for (char c : key) {
+            uint64_t first = firstChild(node), last = firstChild(node + 1);
+            // the children are sorted by their character
+            const char *begin = labels + first, *end = labels + last;
+            const char *child = std::lower_bound(begin, end, c, [](char a, char b) { return static_cast<unsigned char>(a) < static_cast<unsigned char>(b); });
+            if (child == end || *child != c) {
+                return -1;
+            }
+            node = child - labels;
+        }
+        return static_cast<int64_t>(node);
+    }
+
+    // calls fn with every value of the keys that start at node, one level of the subtree at a time
+    template <typename Fn>
+    void forEachValue(uint64_t node, Fn fn) const {
+        uint64_t lo = node, hi = node + 1;
+        while (lo < hi) {
+            for (uint64_t each = lo; each < hi; each++) {
+                if (ends[each / 64] >> (each % 64) & 1) {
+                    uint64_t key = rankEnds(each);
+                    for (uint32_t v = offsets[key]; v < offsets[key + 1]; v++) {
+                        fn(values[v]);
+                    }
+                }
+            }
+            // the children of [lo, hi) are the nodes from the first child of lo to the first child of hi
+            uint64_t nextLo = firstChild(lo);
+            hi = firstChild(hi);
+            lo = nextLo;
+        }
+    }
+
+   private:
+    // children of node v start after the (v + 1)th zero of the shape, and the ones before it are their ids
+    uint64_t firstChild(uint64_t node) const {
+        if (node >= nodeCount) {
+            return nodeCount;
+        }
+        return select0(node + 1) - node;
+    }
+
+    // position of the kth zero of the shape, k from 1
+    uint64_t select0(uint64_t k) const {
+        uint64_t sample = (k - 1) / LOUDS_SELECT_SAMPLE;
+        uint64_t position = samples[sample];
+        uint64_t skip = (k - 1) % LOUDS_SELECT_SAMPLE;
+        uint64_t word = position / 64;
+        uint64_t zeros = ~shape[word] & (~0ull << (position % 64));
+        while (true) {
+            uint64_t count = popcount64(zeros);
+            if (skip < count) {
+                for (; skip > 0; skip--) {
+                    zeros &= zeros - 1;
+                }
+                return word * 64 + trailingZeros64(zeros);
+            }
+            skip -= count;
+            zeros = ~shape[++word];
+        }
+    }
+
+    // number of end marks before node
+    uint64_t rankEnds(uint64_t node) const {
+        uint64_t block = node / LOUDS_RANK_BLOCK;
+        uint64_t rank = ranks[block];
+        for (uint64_t word = block * (LOUDS_RANK_BLOCK / 64); word < node / 64; word++) {
+            rank += popcount64(ends[word]);
+        }
+        if (node % 64) {
+            rank += popcount64(ends[node / 64] & ((1ull << (node % 64)) - 1));
+        }
+        return rank;
+    }
+
+    uint64_t nodeCount = 0;
+    uint64_t shapeBits = 0;
+    uint64_t sampleCount = 0;
+    uint64_t keyCount = 0;
+    uint64_t valueCount = 0;
+    const uint64_t *shape = nullptr;
+    const uint64_t *samples = nullptr;
+    const uint64_t *ends = nullptr;
+    const uint32_t *ranks = nullptr;
+    const char *labels = nullptr;
+    const uint32_t *offsets = nullptr;
+    const uint32_t *values = nullptr;
+};
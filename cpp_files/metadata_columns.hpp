@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "mapped_file.hpp"
+
+// size, modification time and type of every name of a file index, next to the file index as .columns
+// row i belongs to entry i of the name blob, so a query on the metadata never touches the filesystem
+// the columns only hold what the directory walk already returns, an inode would cost a call per file (a handle
+// open on windows), so the duplicate finder, the one user of it, reads it for the few files it compares
+// file layout: magic, row count, then one array per column: sizes (u64), mtimes (i64, unix seconds), types (u8);
+// every array starts 8-byte aligned so the file is used in place through a memory mapping
+
+enum FileType : uint8_t { TYPE_UNKNOWN = 0, TYPE_FILE = 1, TYPE_DIRECTORY = 2, TYPE_SYMLINK = 3, TYPE_OTHER = 4 };
+
+struct FileMeta {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint8_t type = TYPE_UNKNOWN;
+};
+
+const char COLUMNS_MAGIC[8] = {'F', 'F', 'C', 'O', 'L', 'S', '0', '2'};
+
+inline bool writeColumns(const std::string &file, const std::vector<FileMeta> &rows) {
+    std::vector<uint64_t> sizes(rows.size());
+    std::vector<int64_t> mtimes(rows.size());
+    std::vector<uint8_t> types(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        sizes[i] = rows[i].size;
+        mtimes[i] = rows[i].mtime;
+        types[i] = rows[i].type;
+    }
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t count = rows.size();
+    bool ok = fwrite(COLUMNS_MAGIC, 1, sizeof(COLUMNS_MAGIC), fp) == sizeof(COLUMNS_MAGIC) &&
+              fwrite(&count, sizeof(count), 1, fp) == 1 &&
+              fwrite(sizes.data(), sizeof(uint64_t), count, fp) == count &&
+              fwrite(mtimes.data(), sizeof(int64_t), count, fp) == count &&
+              fwrite(types.data(), 1, count, fp) == count;
+    return fclose(fp) == 0 && ok;
+}
+
+// the columns of a mapped .columns file, the pointers are into the mapping
+struct ColumnView {
+    uint64_t count = 0;
+    const uint64_t *size = nullptr;
+    const int64_t *mtime = nullptr;
+    const uint8_t *type = nullptr;
+
+    bool open(const MappedFile &file) {
+        const size_t header = sizeof(COLUMNS_MAGIC) + sizeof(uint64_t);
+        if (!file.valid() || file.size() < header || memcmp(file.data(), COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(&count, file.data() + sizeof(COLUMNS_MAGIC), sizeof(count));
+        if (file.size() != header + count * (2 * sizeof(uint64_t) + 1)) {
+            count = 0;
+            return false;
+        }
+        const char *at = file.data() + header;
+        size = reinterpret_cast<const uint64_t *>(at);
+        mtime = reinterpret_cast<const int64_t *>(at + count * sizeof(uint64_t));
+        type = reinterpret_cast<const uint8_t *>(at + 2 * count * sizeof(uint64_t));
+        return true;
+    }
+
+    FileMeta row(size_t i) const { return {size[i], mtime[i], type[i]}; }
+};
+
+// ---- predicates ----
+// rows are tested 64 at a time, each column predicate gives a bitmask of the rows it keeps and the masks are
+// and-ed, so a row costs a few vector compares per column instead of a branch per condition
+struct MetaFilter {
+    uint64_t minSize = 0;
+    uint64_t maxSize = UINT64_MAX;
+    int64_t minMtime = INT64_MIN;
+    int64_t maxMtime = INT64_MAX;
+    uint8_t type = TYPE_UNKNOWN;  // TYPE_UNKNOWN keeps every type
+
+    bool bySize() const { return minSize > 0 || maxSize < UINT64_MAX; }
+    bool byTime() const { return minMtime > INT64_MIN || maxMtime < INT64_MAX; }
+    bool active() const { return bySize() || byTime() || type != TYPE_UNKNOWN; }
+
+    // the same test on one row, for metadata that was not read from the columns
+    bool keeps(const FileMeta &meta) const {
+        return meta.size >= minSize && meta.size <= maxSize && meta.mtime >= minMtime && meta.mtime <= maxMtime &&
+               (type == TYPE_UNKNOWN || meta.type == type);
+    }
+};
+
+inline int lowestBit64(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward64(&bit, mask);
+    return static_cast<int>(bit);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// bit i is set when lo <= values[i] <= hi, for n <= 64 values
+// avx2 only has a signed 64-bit compare, unsigned values are compared with their top bit flipped
+template <typename T>
+inline uint64_t rangeMask(const T *values, size_t n, T lo, T hi) {
+    uint64_t mask = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i flip = _mm256_set1_epi64x(std::is_signed<T>::value ? 0 : static_cast<long long>(1ull << 63));
+    const __m256i low = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(lo)), flip);
+    const __m256i high = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(hi)), flip);
+    for (; i + 4 <= n; i += 4) {
+        __m256i value = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)), flip);
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(low, value), _mm256_cmpgt_epi64(value, high));
+        mask |= static_cast<uint64_t>(~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF) << i;
+    }
+#endif
+    // without avx2 the branch-free loop is left to the compiler's vectorizer
+    for (; i < n; i++) {
+        mask |= static_cast<uint64_t>(values[i] >= lo && values[i] <= hi) << i;
+    }
+    return mask;
+}
+
+// bit i is set when types[i] == type, for n <= 64 values
+inline uint64_t typeMask(const uint8_t *types, size_t n, uint8_t type) {
+    uint64_t mask = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i wanted = _mm256_set1_epi8(static_cast<char>(type));
+    for (; i + 32 <= n; i += 32) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(types + i));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, wanted)))) << i;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i wanted = _mm_set1_epi8(static_cast<char>(type));
+    for (; i + 16 <= n; i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(types + i));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(value, wanted)))) << i;
+    }
+#endif
+    for (; i < n; i++) {
+        mask |= static_cast<uint64_t>(types[i] == type) << i;
+    }
+    return mask;
+}
+
+// rows that pass every predicate of the filter, ascending
+inline std::vector<uint32_t> selectRows(const ColumnView &columns, const MetaFilter &filter) {
+    std::vector<uint32_t> rows;
+    for (uint64_t block = 0; block < columns.count; block += 64) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(64, columns.count - block));
+        uint64_t mask = n == 64 ? ~0ull : (1ull << n) - 1;
+        if (filter.bySize()) {
+            mask &= rangeMask(columns.size + block, n, filter.minSize, filter.maxSize);
+        }
+        if (mask && filter.byTime()) {
+            mask &= rangeMask(columns.mtime + block, n, filter.minMtime, filter.maxMtime);
+        }
+        if (mask && filter.type != TYPE_UNKNOWN) {
+            mask &= typeMask(columns.type + block, n, filter.type);
+        }
+        while (mask) {
+            rows.push_back(static_cast<uint32_t>(block + lowestBit64(mask)));
+            mask &= mask - 1;
+        }
+    }
+    return rows;
+}
+
+// ---- collecting and parsing ----
+
+// seconds since 1970 of a file time, file_time_type has no fixed epoch before c++20
+inline int64_t unixSeconds(std::filesystem::file_time_type time) {
+    auto system = std::chrono::system_clock::now() + std::chrono::duration_cast<std::chrono::system_clock::duration>(time - std::filesystem::file_time_type::clock::now());
+    return std::chrono::duration_cast<std::chrono::seconds>(system.time_since_epoch()).count();
+}
+
+inline int64_t unixNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// metadata of a crawled entry, from what the directory iterator already read where the platform allows it
+inline FileMeta fileMeta(const std::filesystem::directory_entry &entry) {
+    FileMeta meta;
+    std::error_code ec;
+    if (entry.is_symlink(ec)) {
+        meta.type = TYPE_SYMLINK;
+    } else if (entry.is_directory(ec)) {
+        meta.type = TYPE_DIRECTORY;
+    } else if (entry.is_regular_file(ec)) {
+        meta.type = TYPE_FILE;
+        uintmax_t size = entry.file_size(ec);
+        meta.size = ec ? 0 : static_cast<uint64_t>(size);
+    } else if (!ec) {
+        meta.type = TYPE_OTHER;
+    }
+    auto modified = entry.last_write_time(ec);
+    if (!ec) {
+        meta.mtime = unixSeconds(modified);
+    }
+    return meta;
+}
+
+// "1500", "64K", "1G", "1GB", "2.5m" --> bytes, the units are powers of 1024
+inline bool parseSize(const std::string &text, uint64_t &bytes) {
+    char *end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) {
+        return false;
+    }
+    std::string unit(end);
+    std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    if (unit.size() == 2 && unit[1] == 'b') {
+        unit.pop_back();
+    }
+    const std::string units = "bkmgt";
+    size_t power = unit.empty() ? 0 : units.find(unit);
+    if (power == std::string::npos || unit.size() > 1) {
+        return false;
+    }
+    bytes = static_cast<uint64_t>(value * static_cast<double>(1ull << (10 * power)));
+    return true;
+}
+
+// "90s", "30m", "12h", "1d", "2w" --> seconds, a bare number is seconds
+inline bool parseAge(const std::string &text, int64_t &seconds) {
+    char *end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) {
+        return false;
+    }
+    std::string unit(end);
+    double scale = unit.empty() || unit == "s" ? 1 : unit == "m" ? 60 : unit == "h" ? 3600 : unit == "d" ? 86400 : unit == "w" ? 604800 : 0;
+    if (scale == 0) {
+        return false;
+    }
+    seconds = static_cast<int64_t>(value * scale);
+    return true;
+}
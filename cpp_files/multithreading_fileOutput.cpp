@@ -5,14 +5,27 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <set>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "../libraries/rapidjson/document.h"
 #include "../libraries/rapidjson/stringbuffer.h"
 #include "../libraries/rapidjson/writer.h"
+#include "dag_index.hpp"
+#include "dir_index.hpp"
+#include "disk_usage.hpp"
+#include "exact_names.hpp"
+#include "index_format.hpp"
+#include "index_publish.hpp"
+#include "louds_trie.hpp"
+#include "metadata_columns.hpp"
+#include "path_dictionary.hpp"
+#include "suffix_index.hpp"
 
 using namespace std;
 namespace fs = filesystem;
@@ -20,13 +33,36 @@ namespace rj = rapidjson;
 
 // functions declarations
 void helper(const vector<fs::path> &dirs);
-void indexer(const fs::directory_entry &ent, rj::Document *extensionData, rj::Document *filenameData, rj::Document::AllocatorType &extensionDataAllocator, rj::Document::AllocatorType &filenameDataAllocator);
+void indexer(const fs::directory_entry &ent, rj::Document *extensionData, rj::Document *filenameData, rj::Document *wordData, rj::Document::AllocatorType &extensionDataAllocator, rj::Document::AllocatorType &filenameDataAllocator);
+void wordIndexer(const string &path, const string &fileName, const string &stem, rj::Document *wordData);
 void writeBuffer();
+void loadIndex(const string &jsonFile, rj::Document &data);
+void loadManifest();
+bool writeManifest();
+void prepareShards(vector<fs::path> &roots);
+ShardInfo &shardFor(const fs::directory_entry &ent);
+ShardInfo &shardWithId(int id);
+string shardPath(const ShardInfo &shard, const string &kind);
+vector<string> liveFiles();
+string indexKey(const fs::path &path);
+void writeIndex(const rj::Document &data, const string &jsonFile);
+void writeNode(const rj::Value &node, rj::Writer<rj::StringBuffer> &writer, rj::StringBuffer &buffer, string &path, vector<DirOffset> &offsets, const unordered_map<const rj::Value *, string> &blooms);
+unordered_set<uint64_t> subtreePrefixes(const rj::Value &node, unordered_map<const rj::Value *, string> &blooms);
+void triePrefixes(const rj::Value &node, string &prefix, unordered_set<uint64_t> &prefixes);
+void collectNames(const rj::Value &node, string &path, NameBlob &blob);
+void trieNames(const rj::Value &node, uint32_t dir, NameBlob &blob);
+void loadMetadata(const string &filenameFile, unordered_map<string, FileMeta> &metadata);
+void mergeUsage(unordered_map<string, DirUsage> &partial);
+void writeUsage();
+void writeLookupSidecars();
+template <typename Write>
+void writeSidecar(const string &indexFile, const string &kind, const string &what, Write write);
 
 // mutexes to protect data
 mutex data_mutex;
 mutex count_mutex;
 mutex indexer_mutex;
+mutex usage_mutex;
 
 // global limitations
 const long MAX_COUNT = 200000;
@@ -36,6 +72,19 @@ int COUNT = 0;
 
 // directories
 deque<fs::directory_entry> filesNFolders = {};
+// index output, one shard per top-level directory of the crawl roots plus the manifest listing them
+const string INDEX_DIR = "../index/";
+vector<ShardInfo> shards = {};
+vector<fs::path> crawlRoots = {};
+int nextShardId = 1;
+// the generation the published manifest lists, every flush of the crawl writes its shards as the next one,
+// which goes live in one piece once the crawl is done and its manifest is published
+IndexPublisher publisher(INDEX_DIR);
+uint64_t generation = 0;
+// shards written by this crawl, their lookup sidecars are built from the final names when it ends
+set<int> crawledShards = {};
+// direct size, file count and directory count of every crawled directory, merged from the workers
+unordered_map<string, DirUsage> dirUsage = {};
 unordered_set<string> ignoredDirectories = {R"(C:\Windows)", R"(C:\ProgramData)", R"(C:\DRIVER)", R"(C:\drivers)", R"(C:\$SysReset)", R"(C:\PerfLogs)", R"(C:\msys64)", R"(C:\vcpkg)", R"(C:\Program Files (x86)\AMD)", R"(C:\Program Files (x86)\Google)", R"(C:\Program Files (x86)\Internet Explorer)", R"(C:\Program Files (x86)\Lenovo)"};
 vector<fs::path> directoriesToParse = {R"(C:\Users)"};
 
@@ -66,12 +115,23 @@ int main() {
                 }
             }
         } else {
-            for (auto &each : directoriesToParse) {
+            initial_dirs = directoriesToParse;
+        }
+
+        // drop the shards that are about to be re-indexed, the others are kept as they are
+        fs::create_directories(INDEX_DIR);
+        loadManifest();
+        // the files of a generation an earlier run never published, and the old ones a reader had open
+        publisher.sweep(liveFiles());
+        prepareShards(initial_dirs);
+        crawlRoots = initial_dirs;
+
+        if (!ignoreDirectories) {
+            for (auto &each : initial_dirs) {
                 fs::directory_entry entry(each);
                 // add the directory to the buffer to add to the json file later on
                 filesNFolders.push_back(entry);
             }
-            initial_dirs = directoriesToParse;
         }
         // create thread vector containing max of MAX_THREADS with assignments about which paths they will parse
         vector<vector<fs::path>> thread_dirs(MAX_THREADS);
@@ -99,6 +159,12 @@ int main() {
         if (!filesNFolders.empty()) {
             writeBuffer();
         }
+        writeLookupSidecars();
+        writeUsage();
+        // the crawl goes live as one generation, without the shards prepareShards dropped
+        if (!writeManifest()) {
+            cerr << "Error publishing the index, it stays at generation " << generation << " until the next run" << endl;
+        }
         thread_dirs.clear();
         initial_dirs.clear();
         threads.clear();
@@ -121,6 +187,9 @@ int main() {
 }
 
 void helper(const vector<fs::path> &dirs) {
+    // disk usage of the directories this thread lists, merged into dirUsage when it is done
+    unordered_map<string, DirUsage> usage;
+
     // iterate through the directories for a thread
     for (const auto &dir : dirs) {
         // keeping a queue for bfs approach for going through the directories
@@ -133,6 +202,7 @@ void helper(const vector<fs::path> &dirs) {
             stack.pop_front();
 
             try {
+                DirUsage &direct = usage[indexKey(current_dir)];
                 // lock the mutex to protect its data from mixing with other threads
                 unique_lock<mutex> guard(data_mutex);
                 for (const auto &entry : fs::directory_iterator(current_dir)) {
@@ -147,6 +217,18 @@ void helper(const vector<fs::path> &dirs) {
                     // add path to the buffer to be written to the json later on
                     filesNFolders.push_back(entry);
 
+                    // symlinks are counted but not followed, like du
+                    error_code ec;
+                    if (entry.is_symlink(ec) || !entry.is_directory(ec)) {
+                        direct.files++;
+                        if (!entry.is_symlink(ec) && entry.is_regular_file(ec)) {
+                            uintmax_t size = entry.file_size(ec);
+                            direct.bytes += ec ? 0 : size;
+                        }
+                    } else {
+                        direct.dirs++;
+                    }
+
                     // if the has reached desired size write it to json
                     if (filesNFolders.size() >= MaxSubFolderInMemory) {
                         cout << "Write Buffer, Count " << COUNT << ", FilesnFolders " << filesNFolders.size();
@@ -154,7 +236,8 @@ void helper(const vector<fs::path> &dirs) {
                     }
 
                     // DEBUGGING -- limiting the amount of files parsed for now for testing purposes
-                    if (fs::is_directory(entry.status()) && !in) {
+                    // a symlinked directory is not entered, its target would be counted a second time under the link
+                    if (entry.is_directory(ec) && !entry.is_symlink(ec) && !in) {
                         COUNT++;
                         if (COUNT % 1000 == 0) cout << "Count: " << COUNT;
                         stack.push_back(entry.path());
@@ -162,6 +245,8 @@ void helper(const vector<fs::path> &dirs) {
 
                     if (COUNT >= MAX_COUNT) {
                         cout << "Max Count passed!";
+                        guard.unlock();
+                        mergeUsage(usage);
                         return;
                     }
                 }
@@ -172,9 +257,55 @@ void helper(const vector<fs::path> &dirs) {
         }
         stack.clear();
     }
+    mergeUsage(usage);
 }
 
-void indexer(const fs::directory_entry &ent, rj::Document *extensionData, rj::Document *filenameData, rj::Document::AllocatorType &extensionDataAllocator, rj::Document::AllocatorType &filenameDataAllocator) {
+void mergeUsage(unordered_map<string, DirUsage> &partial) {
+    unique_lock<mutex> guard(usage_mutex);
+    for (const auto &[key, each] : partial) {
+        dirUsage[key].add(each);
+    }
+    partial.clear();
+}
+
+void writeUsage() {
+    // the shard each directory is written to: the crawl root to its flat shard, everything else to the shard
+    // of the top-level directory it is in
+    map<pair<string, bool>, int> shardIds;
+    for (const auto &shard : shards) {
+        shardIds[{shard.prefix, shard.flat}] = shard.id;
+    }
+    unordered_set<string> boundaries;
+    map<int, vector<UsageRow>> shardRows;
+    for (const auto &root : crawlRoots) {
+        string rootKey = indexKey(root);
+        for (const auto &[key, each] : dirUsage) {
+            if (key.compare(0, rootKey.size(), rootKey) != 0) {
+                continue;
+            }
+            bool flat = key == rootKey;
+            string prefix = flat ? key : key.substr(0, key.find('/', rootKey.size()) + 1);
+            if (prefix == key && !flat) {
+                boundaries.insert(key);
+            }
+            auto id = shardIds.find({prefix, flat});
+            if (id != shardIds.end()) {
+                shardRows[id->second].push_back({key, {}});
+            }
+        }
+    }
+
+    // sums of a shard stop at its top directory, the searcher adds the shard tops into the crawl root
+    rollUp(dirUsage, boundaries);
+    for (auto &[id, rows] : shardRows) {
+        for (auto &row : rows) {
+            row.second = dirUsage[row.first];
+        }
+        writeSidecar(shardPath(shardWithId(id), "file"), "usage", "disk usage", [&](const string &file) { return writeUsageTable(file, rows); });
+    }
+}
+
+void indexer(const fs::directory_entry &ent, rj::Document *extensionData, rj::Document *filenameData, rj::Document *wordData, rj::Document::AllocatorType &extensionDataAllocator, rj::Document::AllocatorType &filenameDataAllocator) {
     // lock mutex to protect data
     unique_lock<mutex> guard(indexer_mutex);
 
@@ -297,92 +428,537 @@ void indexer(const fs::directory_entry &ent, rj::Document *extensionData, rj::Do
         }
     }
     loc_data = nullptr;
+
+    // the same name under the words inside it
+    wordIndexer(path, fileName, fileName1, wordData);
+}
+
+void wordIndexer(const string &path, const string &fileName, const string &stem, rj::Document *wordData) {
+    vector<string> keys = wordKeys(stem);
+    if (keys.empty()) {
+        return;
+    }
+    rj::Document::AllocatorType &allocator = wordData->GetAllocator();
+
+    // same directory objects as in the file index
+    rj::Value *dir = wordData;
+    size_t oldFind = 0;
+    size_t newFind = path.find('\\', oldFind + 1);
+    while (newFind != string::npos) {
+        string ppp = path.substr(oldFind, newFind - oldFind) + '/';
+        if (!dir->HasMember(ppp.c_str())) {
+            rj::Value val(ppp.c_str(), allocator);
+            rj::Value obj(rj::kObjectType);
+            dir->AddMember(val, obj, allocator);
+        }
+        dir = &(*dir)[ppp.c_str()];
+        oldFind = newFind + 1;
+        newFind = path.find('\\', oldFind);
+    }
+
+    for (const auto &key : keys) {
+        rj::Value *loc_data = dir;
+        for (char c : key) {
+            char chr[2] = {c, 0};
+            if (!loc_data->HasMember(chr)) {
+                rj::Value val(chr, allocator);
+                rj::Value obj(rj::kObjectType);
+                loc_data->AddMember(val, obj, allocator);
+            }
+            loc_data = &(*loc_data)[chr];
+        }
+        if (!loc_data->HasMember("END")) {
+            rj::Value arr(rj::kArrayType);
+            loc_data->AddMember("END", arr, allocator);
+        }
+        rj::Value str(fileName.c_str(), allocator);
+        loc_data->FindMember("END")->value.PushBack(str, allocator);
+    }
 }
 
 void writeBuffer() {
     // loack mutex to guard data
     unique_lock<mutex> guard(count_mutex);
-    // open files
-    ifstream filenameJson("../fileIndex.json", ios::in | ios::binary);
-    ifstream extensionJson("../extIndex.json", ios::in | ios::binary);
 
-    if (!filenameJson.is_open() || !extensionJson.is_open()) {
-        cerr << "Error opening files for reading!" << endl;
-        exit(202);
+    // group the buffer by shard so only the shards that got new entries are read and rewritten
+    map<int, vector<const fs::directory_entry *>> shardEntries;
+    for (const auto &each : filesNFolders) {
+        shardEntries[shardFor(each).id].push_back(&each);
+    }
+
+    for (const auto &[id, entries] : shardEntries) {
+        ShardInfo &shard = shardWithId(id);
+
+        // initialize extensionData and filenameData json file documents
+        rj::Document extensionData;
+        rj::Document filenameData;
+        rj::Document wordData;
+        loadIndex(shardPath(shard, "ext"), extensionData);
+        loadIndex(shardPath(shard, "file"), filenameData);
+        loadIndex(shardPath(shard, "word"), wordData);
+
+        // allocators that are used for create members
+        rj::Document::AllocatorType &filenameDataAllocator = filenameData.GetAllocator();
+        rj::Document::AllocatorType &extensionDataAllocator = extensionData.GetAllocator();
+
+        // metadata of the names written by the earlier flushes of the shard, keyed by full path
+        unordered_map<string, FileMeta> metadata;
+        loadMetadata(shardPath(shard, "file"), metadata);
+
+        // the merged shard is written as the next generation, the files a reader may have open stay as they are
+        // and a later flush of the crawl reads the shard back from the new ones
+        shard.generation = generation + 1;
+        string filenameFile = shardPath(shard, "file");
+        string extensionFile = shardPath(shard, "ext");
+        string wordFile = shardPath(shard, "word");
+
+        // index each path of the shard
+        for (const auto *each : entries) {
+            indexer(*each, &extensionData, &filenameData, &wordData, extensionDataAllocator, filenameDataAllocator);
+            metadata[indexKey(each->path().parent_path()) + each->path().filename().string()] = fileMeta(*each);
+        }
+
+        // write into the files
+        writeIndex(filenameData, filenameFile);
+        writeIndex(extensionData, extensionFile);
+        writeIndex(wordData, wordFile);
+
+        // every name of the shard packed together for the brute force scan engine
+        NameBlob names;
+        string path;
+        collectNames(filenameData, path, names);
+        writeSidecar(filenameFile, "names", "name blob", [&](const string &file) { return writeNameBlob(file, names); });
+
+        // size, mtime and type of every name, in the order of the name blob
+        vector<FileMeta> columns;
+        columns.reserve(names.entries.size());
+        for (size_t i = 0; i < names.entries.size(); i++) {
+            auto found = metadata.find(names.path(i));
+            columns.push_back(found != metadata.end() ? found->second : FileMeta());
+        }
+        writeSidecar(filenameFile, "columns", "metadata columns", [&](const string &file) { return writeColumns(file, columns); });
+
+        // the lookup structures are derived once the crawl is done with the shard
+        crawledShards.insert(id);
     }
-    // initialize extensionData and filenameData json file documents
-    rj::Document extensionData;
-    rj::Document filenameData;
 
-    // allocators that are used for create members
-    rj::Document::AllocatorType &filenameDataAllocator = filenameData.GetAllocator();
-    rj::Document::AllocatorType &extensionDataAllocator = extensionData.GetAllocator();
+    // release buffer
+    filesNFolders.clear();
+}
+
+void loadIndex(const string &jsonFile, rj::Document &data) {
+    // a shard that has not been written yet starts as an empty object
+    ifstream inFile(jsonFile, ios::in | ios::binary);
+    if (!inFile.is_open()) {
+        data.SetObject();
+        return;
+    }
 
-    // read the entire content of the extensionJson file into a string
-    string extJsonContent((istreambuf_iterator<char>(extensionJson)), istreambuf_iterator<char>());
+    // read the entire content of the file into a string
+    string jsonContent((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+    inFile.close();
 
     // if not empty parse the json with c_str
-    if (!extJsonContent.empty()) {
-        rj::ParseResult extParseResult = extensionData.Parse(extJsonContent.c_str());
-        if (!extParseResult) {
-            cerr << "Error parsing extensionJson: " << rj::GetParseErrorFunc(extParseResult.Code())
-                 << " at offset " << extParseResult.Offset() << endl;
+    if (!jsonContent.empty()) {
+        rj::ParseResult parseResult = data.Parse(jsonContent.c_str());
+        if (!parseResult) {
+            cerr << "Error parsing " << jsonFile << ": " << rj::GetParseErrorFunc(parseResult.Code())
+                 << " at offset " << parseResult.Offset() << endl;
             exit(404);
         }
     } else {
-        extensionData.SetObject();
+        data.SetObject();
+    }
+}
+
+void writeIndex(const rj::Document &data, const string &jsonFile) {
+    // bloom filters of the name prefixes below each directory, written as the first key of the directory
+    unordered_map<const rj::Value *, string> blooms;
+    subtreePrefixes(data, blooms);
+
+    // serialize the document while keeping track of where every directory object starts and ends
+    rj::StringBuffer buffer;
+    rj::Writer<rj::StringBuffer> writer(buffer);
+    vector<DirOffset> offsets;
+    string path;
+    writeNode(data, writer, buffer, path, offsets, blooms);
+
+    // a file of the next generation, no reader opens it before the manifest listing it is published
+    ofstream outFile(publisher.stage(jsonFile), ios::out | ios::trunc | ios::binary);
+    if (!outFile.is_open()) {
+        cerr << "Error opening files for writing!" << endl;
+        exit(202);
     }
-    extJsonContent.clear();
+    outFile.write(buffer.GetString(), buffer.GetSize());
+    outFile.close();
 
-    // read the entire content of the extensionJson file into a string
-    string fileJsonContent((istreambuf_iterator<char>(filenameJson)), istreambuf_iterator<char>());
+    // the offset table lets the searcher read only the bytes of the directory it searches in
+    writeSidecar(jsonFile, "offsets", "offset table", [&](const string &file) { return writeOffsetTable(file, buffer.GetSize(), offsets); });
+}
 
-    // if not empty parse the json with c_str
-    if (!fileJsonContent.empty()) {
-        rj::ParseResult fileParseResult = filenameData.Parse(fileJsonContent.c_str());
-        if (!fileParseResult) {
-            cerr << "Error parsing filenameJson: " << rj::GetParseErrorFunc(fileParseResult.Code())
-                 << " at offset " << fileParseResult.Offset() << endl;
-            exit(404);
+void writeNode(const rj::Value &node, rj::Writer<rj::StringBuffer> &writer, rj::StringBuffer &buffer, string &path, vector<DirOffset> &offsets, const unordered_map<const rj::Value *, string> &blooms) {
+    writer.StartObject();
+    // the writer has just put the '{' of this object in the buffer
+    size_t begin = buffer.GetSize() - 1;
+
+    // the bloom filter goes first so a streaming reader sees it before the subtree
+    auto bloom = blooms.find(&node);
+    if (!path.empty() && bloom != blooms.end()) {
+        writer.Key(BLOOM_KEY.c_str(), BLOOM_KEY.size());
+        writer.String(bloom->second.c_str(), bloom->second.size());
+    }
+
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        const char *key = member->name.GetString();
+        rj::SizeType keyLength = member->name.GetStringLength();
+        // bloom filters read back from an older version of the file are replaced by the new ones
+        if (BLOOM_KEY == key) {
+            continue;
+        }
+        writer.Key(key, keyLength);
+
+        // only directory keys ("folder/") hold nested directories, the character tries are written as they are
+        if (keyLength > 0 && key[keyLength - 1] == '/' && member->value.IsObject()) {
+            size_t pathLength = path.size();
+            path.append(key, keyLength);
+            writeNode(member->value, writer, buffer, path, offsets, blooms);
+            path.resize(pathLength);
+        } else {
+            member->value.Accept(writer);
+        }
+    }
+    writer.EndObject();
+
+    // the root object has no directory path
+    if (!path.empty()) {
+        offsets.push_back({pathHash(path), begin, buffer.GetSize() - begin});
+    }
+}
+unordered_set<uint64_t> subtreePrefixes(const rj::Value &node, unordered_map<const rj::Value *, string> &blooms) {
+    // collect the hashes of the name prefixes of this directory and every directory below it
+    unordered_set<uint64_t> prefixes;
+    string prefix;
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        const char *key = member->name.GetString();
+        rj::SizeType keyLength = member->name.GetStringLength();
+        if (!member->value.IsObject() || keyLength == 0) {
+            continue;
+        }
+        if (key[keyLength - 1] == '/') {
+            unordered_set<uint64_t> child = subtreePrefixes(member->value, blooms);
+            // merge the smaller set into the bigger one
+            if (child.size() > prefixes.size()) {
+                swap(child, prefixes);
+            }
+            prefixes.insert(child.begin(), child.end());
+        } else {
+            // first character of a name in the character trie of this directory
+            prefix.assign(key, keyLength);
+            triePrefixes(member->value, prefix, prefixes);
         }
-    } else {
-        filenameData.SetObject();
     }
 
-    fileJsonContent.clear();
+    blooms[&node] = bloomBuild(vector<uint64_t>(prefixes.begin(), prefixes.end()));
+    return prefixes;
+}
 
-    // close files
-    filenameJson.close();
-    extensionJson.close();
+void triePrefixes(const rj::Value &node, string &prefix, unordered_set<uint64_t> &prefixes) {
+    // every path of the trie up to BLOOM_PREFIX characters is the prefix of at least one name
+    prefixes.insert(pathHash(prefix));
+    if (prefix.size() >= BLOOM_PREFIX) {
+        return;
+    }
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        if (member->value.IsObject() && member->name.GetStringLength() == 1) {
+            prefix.push_back(member->name.GetString()[0]);
+            triePrefixes(member->value, prefix, prefixes);
+            prefix.pop_back();
+        }
+    }
+}
 
-    // index each path in filesNfolders buffer
-    for (const auto &each : filesNFolders) {
-        indexer(each, &extensionData, &filenameData, extensionDataAllocator, filenameDataAllocator);
+void collectNames(const rj::Value &node, string &path, NameBlob &blob) {
+    // the names of this directory first, then the directories below it
+    uint32_t dir = blob.addDir(path);
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        if (member->value.IsObject() && member->name.GetStringLength() == 1) {
+            trieNames(member->value, dir, blob);
+        }
+    }
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        const char *key = member->name.GetString();
+        rj::SizeType keyLength = member->name.GetStringLength();
+        if (keyLength > 0 && key[keyLength - 1] == '/' && member->value.IsObject()) {
+            size_t pathLength = path.size();
+            path.append(key, keyLength);
+            collectNames(member->value, path, blob);
+            path.resize(pathLength);
+        }
     }
+}
 
-    // open files as output stream with truncation
-    ofstream outFileFilename("../fileIndex.json", ios::out | ios::trunc | ios::binary);
-    ofstream outFileExtension("../extIndex.json", ios::out | ios::trunc | ios::binary);
+void trieNames(const rj::Value &node, uint32_t dir, NameBlob &blob) {
+    for (auto member = node.MemberBegin(); member != node.MemberEnd(); ++member) {
+        if (member->value.IsObject() && member->name.GetStringLength() == 1) {
+            trieNames(member->value, dir, blob);
+        } else if (member->value.IsArray()) {
+            // "END": the names that end at this node
+            for (const auto &name : member->value.GetArray()) {
+                if (name.IsString()) {
+                    blob.addName(dir, name.GetString(), name.GetStringLength());
+                }
+            }
+        }
+    }
+}
+
+void loadMetadata(const string &filenameFile, unordered_map<string, FileMeta> &metadata) {
+    // the rows of the columns line up with the entries of the name blob written next to them
+    NameBlob names;
+    MappedFile file(sidecarPath(filenameFile, "columns"));
+    ColumnView columns;
+    if (!readNameBlob(sidecarPath(filenameFile, "names"), names) || !columns.open(file) || columns.count != names.entries.size()) {
+        return;
+    }
+    metadata.reserve(names.entries.size());
+    for (size_t i = 0; i < names.entries.size(); i++) {
+        metadata[names.path(i)] = columns.row(i);
+    }
+}
+
+void loadManifest() {
+    shards.clear();
+    ifstream manifestFile(INDEX_DIR + MANIFEST_FILE, ios::in | ios::binary);
+    if (!manifestFile.is_open()) {
+        return;
+    }
+    string content((istreambuf_iterator<char>(manifestFile)), istreambuf_iterator<char>());
 
-    if (!outFileFilename.is_open() || !outFileExtension.is_open()) {
+    rj::Document manifest;
+    if (manifest.Parse(content.c_str()).HasParseError() || !manifest.IsObject() || !manifest.HasMember("shards") || !manifest["shards"].IsArray()) {
+        cerr << "Error parsing manifest, starting a new index" << endl;
+        return;
+    }
+    if (manifest.HasMember("generation") && manifest["generation"].IsUint64()) {
+        generation = manifest["generation"].GetUint64();
+    }
+    for (const auto &each : manifest["shards"].GetArray()) {
+        if (!each.IsObject() || !each.HasMember("id") || !each["id"].IsInt() || !each.HasMember("prefix") || !each["prefix"].IsString() ||
+            !each.HasMember("flat") || !each["flat"].IsBool()) {
+            cerr << "Skipping a manifest entry without an id, prefix or flat flag" << endl;
+            continue;
+        }
+        // the files of an index written before the generations were in their names have none
+        uint64_t shardGeneration = each.HasMember("generation") && each["generation"].IsUint64() ? each["generation"].GetUint64() : 0;
+        ShardInfo shard = {each["id"].GetInt(), each["prefix"].GetString(), each["flat"].GetBool(), shardGeneration};
+        nextShardId = max(nextShardId, shard.id + 1);
+        shards.push_back(shard);
+    }
+}
+
+bool writeManifest() {
+    rj::StringBuffer buffer;
+    rj::Writer<rj::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("version");
+    writer.Int(1);
+    // one more with every publication, the searcher can tell two versions of the index apart
+    writer.Key("generation");
+    writer.Uint64(generation + 1);
+    writer.Key("shards");
+    writer.StartArray();
+    for (const auto &shard : shards) {
+        writer.StartObject();
+        writer.Key("id");
+        writer.Int(shard.id);
+        writer.Key("prefix");
+        writer.String(shard.prefix.c_str());
+        writer.Key("flat");
+        writer.Bool(shard.flat);
+        // the generation the files of the shard were written in, the searcher opens no other
+        writer.Key("generation");
+        writer.Uint64(shard.generation);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    // written next to the published manifest and renamed over it, the rename publishes the whole generation
+    ofstream outFile(INDEX_DIR + MANIFEST_FILE + STAGED_SUFFIX, ios::out | ios::trunc | ios::binary);
+    if (!outFile.is_open()) {
         cerr << "Error opening files for writing!" << endl;
         exit(202);
     }
+    outFile.write(buffer.GetString(), buffer.GetSize());
+    outFile.close();
+    if (!publisher.publish(INDEX_DIR + MANIFEST_FILE, liveFiles())) {
+        // a reader on windows kept the manifest open through every retry, the staged files are swept by the next run
+        return false;
+    }
+    generation++;
+    return true;
+}
 
-    // write into the files
-    rj::StringBuffer filenameBuffer;
-    rj::Writer<rj::StringBuffer> writer1(filenameBuffer);
-    filenameData.Accept(writer1);
-    outFileFilename.write(filenameBuffer.GetString(), filenameBuffer.GetSize());
+void prepareShards(vector<fs::path> &roots) {
+    for (auto &root : roots) {
+        // a root inside an existing shard re-indexes that whole shard, its entries can't be removed one by one
+        string key = indexKey(root);
+        for (const auto &shard : shards) {
+            if (!shard.flat && key.compare(0, shard.prefix.size(), shard.prefix) == 0) {
+                cout << "Re-indexing shard " << shard.prefix << " for " << root.string() << endl;
+                root = fs::path(shard.prefix.substr(0, shard.prefix.size() - 1)).make_preferred();
+                key = shard.prefix;
+                break;
+            }
+        }
 
-    rj::StringBuffer extensionBuffer;
-    rj::Writer<rj::StringBuffer> writer2(extensionBuffer);
-    extensionData.Accept(writer2);
-    outFileExtension.write(extensionBuffer.GetString(), extensionBuffer.GetSize());
+        // every shard below the root is rebuilt from scratch by this crawl, the old files stay searchable
+        // until the first manifest without them is published, the sweep after it deletes them
+        for (auto it = shards.begin(); it != shards.end();) {
+            if (it->prefix.compare(0, key.size(), key) == 0) {
+                it = shards.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // two roots may have been widened to the same shard
+    sort(roots.begin(), roots.end());
+    roots.erase(unique(roots.begin(), roots.end()), roots.end());
+}
 
-    outFileFilename.close();
-    outFileExtension.close();
+ShardInfo &shardFor(const fs::directory_entry &ent) {
+    const fs::path &path = ent.path();
+    string key;
+    bool flat = true;
 
-    // release buffer
-    filesNFolders.clear();
-}
\ No newline at end of file
+    for (const auto &root : crawlRoots) {
+        fs::path relative = path.lexically_relative(root);
+        if (relative.empty() || *relative.begin() == "..") {
+            continue;
+        }
+        if (relative == "." || (distance(relative.begin(), relative.end()) == 1 && !fs::is_directory(ent.status()))) {
+            // the crawl root itself and the files directly inside it
+            key = indexKey(root);
+        } else {
+            // everything below a top-level directory, including the directory itself
+            key = indexKey(root / *relative.begin());
+            flat = false;
+        }
+        break;
+    }
+    if (key.empty()) {
+        key = indexKey(path.parent_path());
+    }
+
+    for (auto &shard : shards) {
+        if (shard.prefix == key && shard.flat == flat) {
+            return shard;
+        }
+    }
+    shards.push_back({nextShardId++, key, flat, generation + 1});
+    return shards.back();
+}
+
+string indexKey(const fs::path &path) {
+    // C:\Users\alice --> C:/Users/alice/ like the directory keys of the index
+    string key = path.string();
+    replace(key.begin(), key.end(), '\\', '/');
+    if (key.empty() || key.back() != '/') {
+        key += '/';
+    }
+    return key;
+}
+
+template <typename Write>
+void writeSidecar(const string &indexFile, const string &kind, const string &what, Write write) {
+    // a side table that can't be written is dropped rather than left behind for the new index, the searcher
+    // goes without it
+    string file = sidecarPath(indexFile, kind);
+    if (!write(publisher.stage(file))) {
+        cerr << "Error writing " << what << " for " << indexFile << endl;
+        publisher.drop(file);
+    }
+}
+
+void writeLookupSidecars() {
+    // built from the name blob and columns of the last flush, an earlier flush would only have its work thrown away
+    for (int id : crawledShards) {
+        string filenameFile = shardPath(shardWithId(id), "file");
+        NameBlob names;
+        MappedFile mapped(sidecarPath(filenameFile, "columns"));
+        ColumnView columns;
+        if (!readNameBlob(sidecarPath(filenameFile, "names"), names) || !columns.open(mapped) || columns.count != names.entries.size()) {
+            cerr << "No name blob for " << filenameFile << ", skipping its lookup sidecars" << endl;
+            continue;
+        }
+
+        // the same paths sorted and front coded, for exact lookups and listing a directory in order
+        vector<string> paths(names.entries.size());
+        for (size_t i = 0; i < names.entries.size(); i++) {
+            paths[i] = names.path(i);
+        }
+        sort(paths.begin(), paths.end());
+        paths.erase(unique(paths.begin(), paths.end()), paths.end());
+        writeSidecar(filenameFile, "paths", "path dictionary", [&](const string &file) { return writePathDictionary(file, paths); });
+
+        // the trie keys of the names as a succinct trie the searcher maps instead of parsing the json trie
+        vector<pair<string, uint32_t>> keyed;
+        keyed.reserve(names.entries.size());
+        for (size_t i = 0; i < names.entries.size(); i++) {
+            const NameEntry &entry = names.entries[i];
+            keyed.push_back({trieKeyOf(fs::path(names.names.substr(entry.offset, entry.length)).stem().string()), static_cast<uint32_t>(i)});
+        }
+        writeSidecar(filenameFile, "louds", "succinct trie", [&](const string &file) { return writeLoudsTrie(file, move(keyed)); });
+
+        // every distinct name and the entries carrying it, for exact name lookups
+        writeSidecar(filenameFile, "exact", "exact name table", [&](const string &file) { return writeExactNames(file, names); });
+
+        // the directories on their own, sorted, for searches that only want directories
+        vector<string> dirs;
+        for (size_t i = 0; i < names.entries.size(); i++) {
+            if (columns.type[i] == TYPE_DIRECTORY) {
+                dirs.push_back(names.path(i));
+            }
+        }
+        sort(dirs.begin(), dirs.end());
+        dirs.erase(unique(dirs.begin(), dirs.end()), dirs.end());
+        writeSidecar(filenameFile, "dirs", "directory index", [&](const string &file) { return writeDirIndex(file, dirs); });
+
+        // the names spelled backwards and sorted, for the names ending with something
+        writeSidecar(filenameFile, "suffix", "suffix index", [&](const string &file) { return writeSuffixIndex(file, names); });
+
+        // the directory tree with identical subtrees stored once
+        writeSidecar(filenameFile, "dag", "shared subtree index", [&](const string &file) { return DagBuilder(names).write(file); });
+    }
+    crawledShards.clear();
+}
+
+ShardInfo &shardWithId(int id) {
+    for (auto &shard : shards) {
+        if (shard.id == id) {
+            return shard;
+        }
+    }
+    cerr << "No shard with id " << id << endl;
+    exit(404);
+}
+
+string shardPath(const ShardInfo &shard, const string &kind) {
+    return shardFile(INDEX_DIR, shard.id, kind, shard.generation);
+}
+
+vector<string> liveFiles() {
+    // every file the manifest of the shards points at, whether the shard has it or not
+    vector<string> files;
+    for (const auto &shard : shards) {
+        for (const auto &kind : INDEX_KINDS) {
+            string file = shardPath(shard, kind);
+            files.push_back(file);
+            for (const auto &sidecar : SIDECAR_KINDS) {
+                files.push_back(sidecarPath(file, sidecar));
+            }
+        }
+    }
+    return files;
+}
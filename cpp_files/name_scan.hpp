@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../libraries/yyjson.h"
+#include "index_format.hpp"
+#include "index_trie.hpp"
+#include "simd_find.hpp"
+
+// brute force substring search over the name blob of a shard: every lowercase name sits in one buffer,
+// which is split between the cores and scanned with a vectorized memmem instead of walking the trie
+
+// entries of the blob whose lowercase name contains "query" and whose directory is below searchDir, in blob order
+// matchCase scans the names as they are instead, for a query that is not lowercase
+inline std::vector<uint32_t> scanNames(const NameBlob &blob, const std::string &searchDir, const std::string &query, unsigned threadCount,
+                                       bool matchCase = false) {
+    const std::string &text = matchCase ? blob.names : blob.lower;
+    std::vector<uint32_t> matches;
+    if (blob.entries.empty()) {
+        return matches;
+    }
+
+    // directories are checked once instead of once per name
+    std::vector<char> inScope = blob.dirsBelow(searchDir);
+
+    // every thread scans a contiguous range of entries, so the results stay in blob order when appended
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, static_cast<unsigned>(blob.entries.size() / 4096 + 1)));
+    std::vector<std::vector<uint32_t>> found(threadCount);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            size_t firstEntry = blob.entries.size() * t / threadCount;
+            size_t endEntry = blob.entries.size() * (t + 1) / threadCount;
+            if (firstEntry == endEntry) {
+                return;
+            }
+            const char *begin = text.data() + blob.entries[firstEntry].offset;
+            const char *end = text.data() + blob.entries[endEntry - 1].offset + blob.entries[endEntry - 1].length;
+            size_t entry = firstEntry;
+            const char *at = begin;
+            while (const char *hit = simdFind(at, end - at, query)) {
+                // names are in offset order, move to the entry holding the hit
+                uint64_t offset = hit - text.data();
+                while (blob.entries[entry].offset + blob.entries[entry].length < offset + query.size()) {
+                    entry++;
+                }
+                if (inScope[blob.entries[entry].dir]) {
+                    found[t].push_back(static_cast<uint32_t>(entry));
+                }
+                // one hit per name is enough, continue with the next name
+                if (++entry == endEntry) {
+                    break;
+                }
+                at = text.data() + blob.entries[entry].offset;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (const auto &each : found) {
+        matches.insert(matches.end(), each.begin(), each.end());
+    }
+    return matches;
+}
+
+// ---- baseline for --bench: walk the tries of the DOM index and check every name ----
+
+inline void trieSubstring(yyjson_val *node, const std::string &dirPath, const std::string &query, std::vector<std::string> &out) {
+    yyjson_val *key, *value;
+    size_t idx, max;
+    std::string lower;
+    yyjson_obj_foreach(node, idx, max, key, value) {
+        if (isTrieKey(key) && yyjson_is_obj(value)) {
+            trieSubstring(value, dirPath, query, out);
+        } else if (yyjson_is_arr(value)) {
+            yyjson_val *each;
+            size_t arrIdx, arrMax;
+            yyjson_arr_foreach(value, arrIdx, arrMax, each) {
+                lower.assign(yyjson_get_str(each), yyjson_get_len(each));
+                std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+                if (lower.find(query) != std::string::npos) {
+                    out.push_back(dirPath + yyjson_get_str(each));
+                }
+            }
+        }
+    }
+}
+
+inline std::vector<std::string> trieSubstringSearch(const std::vector<DirRef> &scopes, const std::string &query) {
+    std::vector<std::string> matches;
+    std::vector<DirRef> level = scopes;
+    while (!level.empty()) {
+        std::vector<DirRef> next;
+        for (const auto &[dir, dirPath] : level) {
+            yyjson_val *key, *value;
+            size_t idx, max;
+            yyjson_obj_foreach(dir, idx, max, key, value) {
+                if (isDirKey(yyjson_get_str(key), yyjson_get_len(key)) && yyjson_is_obj(value)) {
+                    next.push_back({value, dirPath + yyjson_get_str(key)});
+                } else if (isTrieKey(key) && yyjson_is_obj(value)) {
+                    trieSubstring(value, dirPath, query, matches);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    return matches;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// every full path of a shard, sorted and front coded, next to the file index as .paths
+// the paths are cut into blocks of PATH_BLOCK_SIZE: the first path of a block is stored whole, every other one
+// as the length it shares with the path before it and the rest, so the long common directory prefixes are
+// stored once per block; a lookup binary searches the block heads and decodes one block from its start
+// file layout: magic, path count, block size, block count, data bytes, block offsets (u64), data
+// lengths are LEB128 varints
+
+const uint32_t PATH_BLOCK_SIZE = 16;
+const char PATH_DICTIONARY_MAGIC[8] = {'F', 'F', 'P', 'A', 'T', 'H', 'S', '1'};
+
+inline void putVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline uint64_t getVarint(const unsigned char *&p) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= static_cast<uint64_t>(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*p++) << shift;
+    return value;
+}
+
+// the whole file for paths, which must be sorted and unique
+inline std::string encodePathDictionary(const std::vector<std::string> &paths) {
+    std::string data;
+    std::vector<uint64_t> blockOffsets;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (i % PATH_BLOCK_SIZE == 0) {
+            blockOffsets.push_back(data.size());
+            putVarint(data, paths[i].size());
+            data += paths[i];
+            continue;
+        }
+        const std::string &previous = paths[i - 1];
+        size_t shared = std::mismatch(previous.begin(), previous.begin() + std::min(previous.size(), paths[i].size()), paths[i].begin()).first - previous.begin();
+        putVarint(data, shared);
+        putVarint(data, paths[i].size() - shared);
+        data.append(paths[i], shared, std::string::npos);
+    }
+
+    uint64_t header[4] = {paths.size(), PATH_BLOCK_SIZE, blockOffsets.size(), data.size()};
+    std::string file(PATH_DICTIONARY_MAGIC, sizeof(PATH_DICTIONARY_MAGIC));
+    file.append(reinterpret_cast<const char *>(header), sizeof(header));
+    file.append(reinterpret_cast<const char *>(blockOffsets.data()), blockOffsets.size() * sizeof(uint64_t));
+    file += data;
+    return file;
+}
+
+inline bool writePathDictionary(const std::string &file, const std::vector<std::string> &paths) {
+    std::string encoded = encodePathDictionary(paths);
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fwrite(encoded.data(), 1, encoded.size(), fp) == encoded.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// read-only view of a .paths file, usually a memory mapping
+class PathDictionary {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint64_t header[4];
+        if (fileSize < sizeof(PATH_DICTIONARY_MAGIC) + sizeof(header) || memcmp(file, PATH_DICTIONARY_MAGIC, sizeof(PATH_DICTIONARY_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(PATH_DICTIONARY_MAGIC), sizeof(header));
+        size_t offsetsAt = sizeof(PATH_DICTIONARY_MAGIC) + sizeof(header);
+        if (header[1] == 0 || fileSize != offsetsAt + header[2] * sizeof(uint64_t) + header[3]) {
+            return false;
+        }
+        count = header[0];
+        blockSize = header[1];
+        blockCount = header[2];
+        blockOffsets = reinterpret_cast<const uint64_t *>(file + offsetsAt);
+        data = reinterpret_cast<const unsigned char *>(file + offsetsAt + blockCount * sizeof(uint64_t));
+        return true;
+    }
+
+    size_t size() const { return count; }
+
+    // the path with the given id, ids are the sorted order
+    std::string at(size_t id) const {
+        std::string path;
+        forEachFrom(id, [&](const std::string &each) {
+            path = each;
+            return false;
+        });
+        return path;
+    }
+
+    // id of the first path not less than key, size() if there is none, exact tells whether it is the key
+    size_t lowerBound(const std::string &key, bool *exact = nullptr) const {
+        // last block whose head is not greater than the key
+        size_t low = 0, high = blockCount;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (compareHead(mid, key) <= 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (exact) {
+            *exact = false;
+        }
+        if (low == 0) {
+            return 0;
+        }
+        size_t block = low - 1;
+        size_t id = block * blockSize;
+        forEachFrom(id, [&](const std::string &each) {
+            int order = each.compare(key);
+            if (order >= 0) {
+                if (exact) {
+                    *exact = order == 0;
+                }
+                return false;
+            }
+            return ++id % blockSize != 0;
+        });
+        return std::min<size_t>(id, count);
+    }
+
+    bool contains(const std::string &key) const {
+        bool exact;
+        lowerBound(key, &exact);
+        return exact;
+    }
+
+    // calls fn with the paths from id on in sorted order until it returns false
+    template <typename Fn>
+    void forEachFrom(size_t id, Fn fn) const {
+        if (id >= count) {
+            return;
+        }
+        size_t block = id / blockSize;
+        const unsigned char *p = data + blockOffsets[block];
+        std::string path;
+        for (size_t each = block * blockSize; each < count; each++) {
+            if (each % blockSize == 0) {
+                p = data + blockOffsets[each / blockSize];
+                uint64_t length = getVarint(p);
+                path.assign(reinterpret_cast<const char *>(p), length);
+                p += length;
+            } else {
+                uint64_t shared = getVarint(p);
+                uint64_t length = getVarint(p);
+                path.resize(shared);
+                path.append(reinterpret_cast<const char *>(p), length);
+                p += length;
+            }
+            if (each >= id && !fn(path)) {
+                return;
+            }
+        }
+    }
+
+   private:
+    int compareHead(size_t block, const std::string &key) const {
+        const unsigned char *p = data + blockOffsets[block];
+        uint64_t length = getVarint(p);
+        int order = memcmp(p, key.data(), std::min<size_t>(length, key.size()));
+        if (order != 0) {
+            return order;
+        }
+        return length < key.size() ? -1 : length > key.size() ? 1 : 0;
+    }
+
+    uint64_t count = 0;
+    uint64_t blockSize = PATH_BLOCK_SIZE;
+    uint64_t blockCount = 0;
+    const uint64_t *blockOffsets = nullptr;
+    const unsigned char *data = nullptr;
+};
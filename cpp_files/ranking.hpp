@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "exact_names.hpp"
+#include "index_format.hpp"
+#include "index_trie.hpp"
+#include "mapped_file.hpp"
+#include "metadata_columns.hpp"
+
+// relevance ranking of search results: how well the name matches, how deep it is below the searched directory,
+// how often it was opened from the app and how recently it was modified
+// candidates go through a bounded heap so ranking n results for the top K costs n log K, the modification times
+// come from the metadata columns of the index, so every candidate is scored whole without touching the filesystem
+
+enum MatchQuality { MATCH_SUBSTRING, MATCH_ACRONYM, MATCH_WORD_START, MATCH_PREFIX, MATCH_EXACT };
+
+// weights of the score, a better match quality always beats depth, opens and recency
+const double RANK_QUALITY_WEIGHT = 1000.0;
+const double RANK_DEPTH_WEIGHT = 10.0;
+const double RANK_ACCESS_WEIGHT = 40.0;   // per doubling of the open count
+const double RANK_ACCESS_MAX = 400.0;
+const double RANK_RECENCY_WEIGHT = 100.0;  // modified right now, halves every RANK_RECENCY_HALF_LIFE_DAYS
+const double RANK_RECENCY_HALF_LIFE_DAYS = 7.0;
+// modification time of a path the index has no columns for, it gets no recency
+const int64_t RANK_NO_MTIME = INT64_MIN;
+
+// opened files are counted in this file of the index directory, one "count<TAB>path" per line
+const std::string ACCESS_FILE = "access_counts.txt";
+
+// number of letters and digits in name[from, end) if their lowercase starts with queryKey, -1 if it does not
+inline long keyPrefixLength(const std::string &name, size_t from, size_t end, const std::string &queryKey) {
+    size_t length = 0;
+    for (size_t i = from; i < end; i++) {
+        unsigned char c = name[i];
+        if (!isalnum(c)) {
+            continue;
+        }
+        if (length < queryKey.size() && tolower(c) != queryKey[length]) {
+            return -1;
+        }
+        length++;
+    }
+    return length < queryKey.size() ? -1 : static_cast<long>(length);
+}
+
+inline MatchQuality matchQuality(const std::string &name, const std::string &queryKey) {
+    size_t dot = name.find_last_of('.');
+    size_t stemEnd = dot == std::string::npos || dot == 0 ? name.size() : dot;
+    long stemLength = keyPrefixLength(name, 0, stemEnd, queryKey);
+    if (stemLength == static_cast<long>(queryKey.size()) || keyPrefixLength(name, 0, name.size(), queryKey) == static_cast<long>(queryKey.size())) {
+        return MATCH_EXACT;
+    }
+    if (stemLength >= 0) {
+        return MATCH_PREFIX;
+    }
+    for (size_t i = 1; i < name.size(); i++) {
+        if (isWordStart(name, i) && keyPrefixLength(name, i, name.size(), queryKey) >= 0) {
+            return MATCH_WORD_START;
+        }
+    }
+    // the initials of the words of the stem, what the word index files "fooBarBaz" under as "fbb"
+    std::string acronym;
+    for (size_t i = 0; i < stemEnd; i++) {
+        if (isWordStart(name, i)) {
+            acronym += static_cast<char>(tolower(static_cast<unsigned char>(name[i])));
+        }
+    }
+    if (acronym.compare(0, queryKey.size(), queryKey) == 0) {
+        return MATCH_ACRONYM;
+    }
+    return MATCH_SUBSTRING;
+}
+
+// local store of how many times each path was opened
+class AccessStore {
+   public:
+    explicit AccessStore(const std::string &file) : file(file) {
+        std::ifstream in(file);
+        uint64_t count;
+        std::string path;
+        while (in >> count && in.get() == '\t' && std::getline(in, path)) {
+            counts[path] = count;
+        }
+    }
+
+    uint64_t count(const std::string &path) const {
+        if (counts.empty()) {
+            return 0;
+        }
+        auto found = counts.find(path);
+        return found == counts.end() ? 0 : found->second;
+    }
+
+    // count one more open of "path" and write the store back
+    bool record(const std::string &path) {
+        counts[path]++;
+        std::ofstream out(file, std::ios::trunc);
+        for (const auto &[each, count] : counts) {
+            out << count << '\t' << each << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+   private:
+    std::string file;
+    std::unordered_map<std::string, uint64_t> counts;
+};
+
+// fills in the modification time of the paths of mtimes that are in the shard of indexFile, from its .columns
+// a path is found through the .exact table of its name, whose entries are the rows of the columns, so the cost
+// follows the number of paths and not the size of the shard, and only the pages of those rows are read
+inline void indexedMtimes(const std::string &indexFile, std::unordered_map<std::string, int64_t> &mtimes) {
+    if (mtimes.empty()) {
+        return;
+    }
+    MappedFile exactFile(sidecarPath(indexFile, "exact"));
+    MappedFile namesFile(sidecarPath(indexFile, "names"));
+    MappedFile columnFile(sidecarPath(indexFile, "columns"));
+    ExactNames table;
+    NameBlobView blob;
+    ColumnView columns;
+    if (!table.open(exactFile.data(), exactFile.size()) || !blob.open(namesFile.data(), namesFile.size()) || !columns.open(columnFile) ||
+        columns.count != blob.count) {
+        return;
+    }
+    for (auto &each : mtimes) {
+        // already found in an earlier shard
+        if (each.second != RANK_NO_MTIME) {
+            continue;
+        }
+        const std::string &path = each.first;
+        auto found = table.find(path.substr(path.find_last_of('/') + 1));
+        for (const uint32_t *entry = found.first; entry != found.second; entry++) {
+            if (blob.path(*entry) == path) {
+                each.second = columns.mtime[*entry];
+                break;
+            }
+        }
+    }
+}
+
+struct RankedResult {
+    std::string path;
+    double score;
+};
+
+class Ranker {
+   public:
+    Ranker(const std::string &userSearch, const std::string &searchDir, size_t k, const AccessStore &access)
+        : queryKey(trieKeyOf(userSearch)), searchDir(searchDir), k(k), access(access), now(unixNow()) {}
+
+    // mtime in unix seconds, RANK_NO_MTIME when it is not known
+    void add(const std::string &path, int64_t mtime) {
+        candidates++;
+        size_t slash = path.find_last_of('/');
+        std::string name = path.substr(slash + 1);
+        size_t depth = path.compare(0, searchDir.size(), searchDir) == 0
+                           ? std::count(path.begin() + searchDir.size(), path.begin() + slash + 1, '/')
+                           : 0;
+
+        double score = RANK_QUALITY_WEIGHT * matchQuality(name, queryKey) - RANK_DEPTH_WEIGHT * depth;
+        uint64_t opens = access.count(path);
+        if (opens > 0) {
+            score += std::min(RANK_ACCESS_MAX, RANK_ACCESS_WEIGHT * std::log2(1.0 + opens));
+        }
+        if (mtime != RANK_NO_MTIME) {
+            double days = static_cast<double>(now - mtime) / 86400.0;
+            score += RANK_RECENCY_WEIGHT * std::exp2(-std::max(0.0, days) / RANK_RECENCY_HALF_LIFE_DAYS);
+        }
+
+        // keep the best K as a min heap, a candidate only gets in by beating the worst of them
+        if (shortlist.size() < k) {
+            shortlist.push({path, score});
+        } else if (score > shortlist.top().score) {
+            shortlist.pop();
+            shortlist.push({path, score});
+        }
+    }
+
+    size_t candidateCount() const { return candidates; }
+
+    // the best K, best first
+    std::vector<RankedResult> results() {
+        std::vector<RankedResult> ranked;
+        while (!shortlist.empty()) {
+            ranked.push_back(shortlist.top());
+            shortlist.pop();
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const RankedResult &a, const RankedResult &b) { return a.score > b.score; });
+        return ranked;
+    }
+
+   private:
+    struct WorseFirst {
+        bool operator()(const RankedResult &a, const RankedResult &b) const { return a.score > b.score; }
+    };
+
+    std::string queryKey;
+    std::string searchDir;
+    size_t k;
+    const AccessStore &access;
+    int64_t now;
+    size_t candidates = 0;
+    std::priority_queue<RankedResult, std::vector<RankedResult>, WorseFirst> shortlist;
+};
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// small regex engine for path searches: the pattern is parsed into a tree, compiled into a thompson nfa and run
+// as a lazily built dfa, so every character of a path costs one table lookup once the states it needs exist
+// syntax: literals, ".", [abc] [a-z] [^abc], \d \w \s \D \W \S and escaped metacharacters, ( ) (?: ), |, * + ?,
+// {m} {m,} {m,n}, "^" at the start and "$" at the end of the pattern, and a leading (?i) for case-insensitive matching
+// without "^" a match may start anywhere, so the pattern is searched for inside the path
+
+class Regex {
+   public:
+    // dfa state that has already matched, only returned when the pattern is not anchored at the end
+    static const int MATCHED = 0;
+
+    explicit Regex(const std::string &pattern) : pattern(pattern) {
+        if (this->pattern.compare(0, 4, "(?i)") == 0) {
+            caseless = true;
+            pos = 4;
+        }
+        if (pos < this->pattern.size() && this->pattern[pos] == '^') {
+            anchoredStart = true;
+            pos++;
+        }
+        size_t end = this->pattern.size();
+        if (end > pos && this->pattern[end - 1] == '$' && !escapedAt(end - 1)) {
+            anchoredEnd = true;
+            this->pattern.pop_back();
+        }
+
+        std::unique_ptr<Node> root = parseAlternation();
+        if (error.empty() && pos < this->pattern.size()) {
+            error = "unexpected ')' at " + std::to_string(pos);
+        }
+        if (!error.empty()) {
+            return;
+        }
+        literal = requiredLiteral(*root).best;
+
+        int match = addState(MATCH, -1, -1);
+        startState = compile(*root, match);
+
+        // dfa state 0 is MATCHED, state 1 the start
+        dfa.push_back({{}, true, {}});
+        dfa[MATCHED].next.fill(MATCHED);
+        std::vector<int> start;
+        addClosure(startState, start);
+        startClosure = start;
+        startDfa = dfaState(start);
+    }
+
+    bool valid() const { return error.empty(); }
+    const std::string &errorMessage() const { return error; }
+    bool isCaseless() const { return caseless; }
+
+    // longest string every match contains, lowercase for (?i) patterns, "" if there is none
+    const std::string &requiredLiteral() const { return literal; }
+
+    int start() const { return startDfa; }
+
+    // feed text to the dfa from "state"
+    int run(int state, const char *text, size_t length) {
+        for (size_t i = 0; i < length && state != MATCHED; i++) {
+            unsigned char c = text[i];
+            int next = dfa[state].next[c];
+            if (next < 0) {
+                next = transition(state, c);
+            }
+            state = next;
+        }
+        return state;
+    }
+
+    // true if the input that led to "state" matches
+    bool accepts(int state) const { return state == MATCHED || (dfa[state].accepting && anchoredEnd); }
+
+    bool search(const char *text, size_t length) { return accepts(run(start(), text, length)); }
+
+    size_t dfaStates() const { return dfa.size(); }
+
+    // number of times the dfa cache was thrown away, states kept by the caller are only valid while it stays the same
+    size_t cacheResets() const { return resets; }
+
+   private:
+    // ---- parse tree ----
+    struct Node {
+        enum Kind { SET, CONCAT, ALTERNATION, STAR, PLUS, QUEST, EMPTY };
+        Kind kind;
+        std::bitset<256> set;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    bool escapedAt(size_t index) const {
+        size_t backslashes = 0;
+        while (index > backslashes && pattern[index - backslashes - 1] == '\\') {
+            backslashes++;
+        }
+        return backslashes % 2 == 1;
+    }
+
+    static std::unique_ptr<Node> makeNode(Node::Kind kind) {
+        std::unique_ptr<Node> node(new Node());
+        node->kind = kind;
+        return node;
+    }
+
+    std::unique_ptr<Node> parseAlternation() {
+        std::unique_ptr<Node> node = makeNode(Node::ALTERNATION);
+        node->children.push_back(parseConcat());
+        while (error.empty() && pos < pattern.size() && pattern[pos] == '|') {
+            pos++;
+            node->children.push_back(parseConcat());
+        }
+        if (node->children.size() == 1) {
+            return std::move(node->children[0]);
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> parseConcat() {
+        std::unique_ptr<Node> node = makeNode(Node::CONCAT);
+        while (error.empty() && pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')') {
+            node->children.push_back(parseRepeat());
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> parseRepeat() {
+        std::unique_ptr<Node> atom = parseAtom();
+        while (error.empty() && pos < pattern.size()) {
+            char c = pattern[pos];
+            if (c == '*' || c == '+' || c == '?') {
+                pos++;
+                std::unique_ptr<Node> repeat = makeNode(c == '*' ? Node::STAR : c == '+' ? Node::PLUS : Node::QUEST);
+                repeat->children.push_back(std::move(atom));
+                atom = std::move(repeat);
+            } else if (c == '{' && pos + 1 < pattern.size() && isdigit(static_cast<unsigned char>(pattern[pos + 1]))) {
+                atom = parseCount(std::move(atom));
+            } else {
+                break;
+            }
+        }
+        return atom;
+    }
+
+    // x{m,n} becomes m copies of x followed by n - m optional copies, x{m,} ends with x*
+    std::unique_ptr<Node> parseCount(std::unique_ptr<Node> atom) {
+        size_t close = pattern.find('}', pos);
+        if (close == std::string::npos) {
+            error = "unclosed '{' at " + std::to_string(pos);
+            return atom;
+        }
+        std::string inside = pattern.substr(pos + 1, close - pos - 1);
+        pos = close + 1;
+        if (inside.size() > 7 || inside.find_first_not_of("0123456789,") != std::string::npos) {
+            error = "bad repeat count {" + inside + "}";
+            return atom;
+        }
+        size_t comma = inside.find(',');
+        int low = std::stoi(inside.substr(0, comma));
+        int high = comma == std::string::npos ? low : comma + 1 == inside.size() ? -1 : std::stoi(inside.substr(comma + 1));
+        if (low > REPEAT_LIMIT || high > REPEAT_LIMIT || (high >= 0 && high < low)) {
+            error = "bad repeat count {" + inside + "}";
+            return atom;
+        }
+        std::unique_ptr<Node> node = makeNode(Node::CONCAT);
+        for (int i = 0; i < low; i++) {
+            node->children.push_back(copy(*atom));
+        }
+        if (high < 0) {
+            std::unique_ptr<Node> star = makeNode(Node::STAR);
+            star->children.push_back(copy(*atom));
+            node->children.push_back(std::move(star));
+        }
+        for (int i = low; i < high; i++) {
+            std::unique_ptr<Node> quest = makeNode(Node::QUEST);
+            quest->children.push_back(copy(*atom));
+            node->children.push_back(std::move(quest));
+        }
+        return node;
+    }
+
+    static std::unique_ptr<Node> copy(const Node &node) {
+        std::unique_ptr<Node> result = makeNode(node.kind);
+        result->set = node.set;
+        for (const auto &child : node.children) {
+            result->children.push_back(copy(*child));
+        }
+        return result;
+    }
+
+    std::unique_ptr<Node> parseAtom() {
+        char c = pattern[pos];
+        if (c == '(') {
+            pos++;
+            if (pattern.compare(pos, 2, "?:") == 0) {
+                pos += 2;
+            }
+            std::unique_ptr<Node> inner = parseAlternation();
+            if (pos >= pattern.size() || pattern[pos] != ')') {
+                error = "missing ')'";
+                return inner;
+            }
+            pos++;
+            return inner;
+        }
+        if (c == '*' || c == '+' || c == '?') {
+            error = std::string("nothing to repeat before '") + c + "' at " + std::to_string(pos);
+            return makeNode(Node::EMPTY);
+        }
+
+        std::unique_ptr<Node> node = makeNode(Node::SET);
+        if (c == '.') {
+            pos++;
+            node->set.set();
+        } else if (c == '[') {
+            parseClass(node->set);
+        } else if (c == '\\') {
+            pos++;
+            if (pos >= pattern.size()) {
+                error = "trailing '\\'";
+                return node;
+            }
+            if (!escapeClass(pattern[pos], node->set)) {
+                node->set.set(static_cast<unsigned char>(pattern[pos]));
+            }
+            pos++;
+        } else {
+            node->set.set(static_cast<unsigned char>(c));
+            pos++;
+        }
+        foldCase(node->set);
+        return node;
+    }
+
+    void parseClass(std::bitset<256> &set) {
+        pos++;
+        bool negate = pos < pattern.size() && pattern[pos] == '^';
+        if (negate) {
+            pos++;
+        }
+        bool first = true;
+        while (pos < pattern.size() && (pattern[pos] != ']' || first)) {
+            first = false;
+            unsigned char low = pattern[pos];
+            if (low == '\\' && pos + 1 < pattern.size()) {
+                pos++;
+                if (escapeClass(pattern[pos], set)) {
+                    pos++;
+                    continue;
+                }
+                low = pattern[pos];
+            }
+            pos++;
+            unsigned char high = low;
+            if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+                high = pattern[pos + 1];
+                pos += 2;
+            }
+            for (int each = low; each <= high; each++) {
+                set.set(each);
+            }
+        }
+        if (pos >= pattern.size()) {
+            error = "missing ']'";
+            return;
+        }
+        pos++;
+        // folded before the flip, [^a] folded afterwards would get 'a' back from 'A'
+        foldCase(set);
+        if (negate) {
+            set.flip();
+        }
+    }
+
+    // \d \w \s and their negations
+    static bool escapeClass(char c, std::bitset<256> &set) {
+        std::bitset<256> members;
+        for (int each = 0; each < 256; each++) {
+            switch (tolower(static_cast<unsigned char>(c))) {
+                case 'd': members[each] = isdigit(each) != 0; break;
+                case 'w': members[each] = isalnum(each) || each == '_'; break;
+                case 's': members[each] = isspace(each) != 0; break;
+                default: return false;
+            }
+        }
+        set |= isupper(static_cast<unsigned char>(c)) ? ~members : members;
+        return true;
+    }
+
+    void foldCase(std::bitset<256> &set) const {
+        if (!caseless) {
+            return;
+        }
+        for (int each = 'a'; each <= 'z'; each++) {
+            if (set[each] || set[toupper(each)]) {
+                set.set(each);
+                set.set(toupper(each));
+            }
+        }
+    }
+
+    // ---- required literal: a string every match contains, used to prefilter candidates ----
+    struct LiteralInfo {
+        bool exact = false;  // the node only matches "text"
+        std::string text;
+        std::string best;  // longest string every match of the node contains
+    };
+
+    LiteralInfo requiredLiteral(const Node &node) const {
+        LiteralInfo info;
+        switch (node.kind) {
+            case Node::EMPTY:
+                info.exact = true;
+                break;
+            case Node::SET: {
+                // one character, or one letter in both cases for (?i)
+                int first = -1;
+                size_t count = node.set.count();
+                for (int each = 0; each < 256 && first < 0; each++) {
+                    if (node.set[each]) {
+                        first = each;
+                    }
+                }
+                if (count == 1 || (caseless && count == 2 && isalpha(first) && node.set[tolower(first)])) {
+                    info.exact = true;
+                    info.text = std::string(1, static_cast<char>(caseless ? tolower(first) : first));
+                    info.best = info.text;
+                }
+                break;
+            }
+            case Node::CONCAT: {
+                info.exact = true;
+                std::string run;
+                for (const auto &child : node.children) {
+                    LiteralInfo part = requiredLiteral(*child);
+                    if (part.exact) {
+                        run += part.text;
+                        continue;
+                    }
+                    info.exact = false;
+                    longest(info.best, run);
+                    longest(info.best, part.best);
+                    run.clear();
+                }
+                longest(info.best, run);
+                if (info.exact) {
+                    info.text = run;
+                }
+                break;
+            }
+            case Node::PLUS: {
+                LiteralInfo part = requiredLiteral(*node.children[0]);
+                info.best = part.exact ? part.text : part.best;
+                break;
+            }
+            default:
+                // alternations and optional parts guarantee nothing
+                break;
+        }
+        return info;
+    }
+
+    static void longest(std::string &best, const std::string &candidate) {
+        if (candidate.size() > best.size()) {
+            best = candidate;
+        }
+    }
+
+    // ---- thompson nfa ----
+    enum StateKind { SET_STATE, SPLIT, MATCH };
+    struct NfaState {
+        StateKind kind;
+        int out;
+        int out1;
+        std::bitset<256> set;
+    };
+
+    int addState(StateKind kind, int out, int out1) {
+        nfa.push_back({kind, out, out1, {}});
+        return static_cast<int>(nfa.size() - 1);
+    }
+
+    // build the states of "node" in front of "next", returns the first of them
+    int compile(const Node &node, int next) {
+        switch (node.kind) {
+            case Node::EMPTY:
+                return next;
+            case Node::SET: {
+                int state = addState(SET_STATE, next, -1);
+                nfa[state].set = node.set;
+                return state;
+            }
+            case Node::CONCAT:
+                for (size_t i = node.children.size(); i-- > 0;) {
+                    next = compile(*node.children[i], next);
+                }
+                return next;
+            case Node::ALTERNATION: {
+                int first = compile(*node.children.back(), next);
+                for (size_t i = node.children.size() - 1; i-- > 0;) {
+                    first = addState(SPLIT, compile(*node.children[i], next), first);
+                }
+                return first;
+            }
+            case Node::STAR: {
+                int split = addState(SPLIT, -1, next);
+                nfa[split].out = compile(*node.children[0], split);
+                return split;
+            }
+            case Node::PLUS: {
+                int split = addState(SPLIT, -1, next);
+                int body = compile(*node.children[0], split);
+                nfa[split].out = body;
+                return body;
+            }
+            case Node::QUEST:
+                return addState(SPLIT, compile(*node.children[0], next), next);
+        }
+        return next;
+    }
+
+    void addClosure(int state, std::vector<int> &states) const {
+        if (state < 0 || std::find(states.begin(), states.end(), state) != states.end()) {
+            return;
+        }
+        states.push_back(state);
+        if (nfa[state].kind == SPLIT) {
+            addClosure(nfa[state].out, states);
+            addClosure(nfa[state].out1, states);
+        }
+    }
+
+    // ---- lazy dfa ----
+    struct DfaState {
+        std::vector<int> states;  // sorted nfa states
+        bool accepting;
+        std::array<int, 256> next;
+    };
+
+    int dfaState(std::vector<int> states) {
+        std::sort(states.begin(), states.end());
+        bool accepting = false;
+        for (int state : states) {
+            accepting |= nfa[state].kind == MATCH;
+        }
+        // an unanchored end is decided as soon as anything matched
+        if (accepting && !anchoredEnd) {
+            return MATCHED;
+        }
+        auto found = dfaIndex.find(states);
+        if (found != dfaIndex.end()) {
+            return found->second;
+        }
+        // too many states for the pattern, start the cache over instead of growing without bound
+        if (dfa.size() >= DFA_STATE_LIMIT) {
+            dfa.resize(1);
+            dfaIndex.clear();
+            resets++;
+            startDfa = dfaState(startClosure);
+        }
+        DfaState state{states, accepting, {}};
+        state.next.fill(-1);
+        dfa.push_back(state);
+        int index = static_cast<int>(dfa.size() - 1);
+        dfaIndex[states] = index;
+        return index;
+    }
+
+    int transition(int from, unsigned char c) {
+        std::vector<int> next;
+        for (int state : dfa[from].states) {
+            if (nfa[state].kind == SET_STATE && nfa[state].set[c]) {
+                addClosure(nfa[state].out, next);
+            }
+        }
+        // unanchored: a new match can start at every character
+        if (!anchoredStart) {
+            for (int state : startClosure) {
+                addClosure(state, next);
+            }
+        }
+        size_t sizeBefore = dfa.size();
+        int to = dfaState(next);
+        // a cache reset invalidated "from", the caller goes on with the new state
+        if (dfa.size() >= sizeBefore && from < static_cast<int>(dfa.size())) {
+            dfa[from].next[c] = to;
+        }
+        return to;
+    }
+
+    static const int REPEAT_LIMIT = 100;
+    static const size_t DFA_STATE_LIMIT = 4096;
+
+    std::string pattern;
+    size_t pos = 0;
+    std::string error;
+    bool caseless = false;
+    bool anchoredStart = false;
+    bool anchoredEnd = false;
+    std::string literal;
+
+    std::vector<NfaState> nfa;
+    int startState = -1;
+    std::vector<int> startClosure;
+    std::vector<DfaState> dfa;
+    std::map<std::vector<int>, int> dfaIndex;
+    int startDfa = -1;
+    size_t resets = 0;
+};
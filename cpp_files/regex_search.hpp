@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "index_format.hpp"
+#include "name_scan.hpp"
+#include "regex_engine.hpp"
+
+// regex over full paths, answered from the name blobs: the longest literal every match must contain is looked
+// for in the directory paths and in the names with the simd scan, only the entries it turns up are run through
+// the dfa, and the dfa state after a directory path is kept so each name only costs its own characters
+
+struct RegexStats {
+    size_t candidates = 0;  // entries the dfa was run on
+    size_t prefilterHits = 0;
+    std::string literal;  // what the prefilter looked for, "" when every entry was a candidate
+};
+
+// minimum length of the required literal before it is worth a prefilter pass
+const size_t REGEX_MIN_LITERAL = 2;
+
+// the longest piece of the literal without a '/', it lies entirely in one directory name or in the name
+inline std::string prefilterLiteral(const std::string &literal) {
+    std::string best;
+    size_t start = 0;
+    while (start <= literal.size()) {
+        size_t slash = literal.find('/', start);
+        size_t end = slash == std::string::npos ? literal.size() : slash;
+        if (end - start > best.size()) {
+            best = literal.substr(start, end - start);
+        }
+        start = end + 1;
+    }
+    return best;
+}
+
+// entries of the blob in scope whose full path matches, in blob order
+inline std::vector<uint32_t> regexSearch(Regex &regex, const NameBlob &blob, const std::string &searchDir, unsigned threadCount, RegexStats &stats) {
+    std::vector<uint32_t> matches;
+    std::vector<char> inScope = blob.dirsBelow(searchDir);
+
+    std::string literal = prefilterLiteral(regex.requiredLiteral());
+    bool prefilter = literal.size() >= REGEX_MIN_LITERAL;
+    std::vector<char> dirHit(blob.dirCount(), !prefilter);
+    std::vector<uint32_t> nameHits;
+    if (prefilter) {
+        stats.literal = literal;
+        // directories whose path contains the literal, every name in them is a candidate
+        std::string dirs = blob.dirs;
+        if (regex.isCaseless()) {
+            std::transform(dirs.begin(), dirs.end(), dirs.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        }
+        for (size_t dir = 0; dir < blob.dirCount(); dir++) {
+            dirHit[dir] = inScope[dir] && simdFind(dirs.data() + blob.dirOffsets[dir], blob.dirOffsets[dir + 1] - blob.dirOffsets[dir], literal) != nullptr;
+        }
+        // names that contain the literal
+        nameHits = scanNames(blob, searchDir, literal, threadCount, !regex.isCaseless());
+        stats.prefilterHits += nameHits.size();
+    }
+
+    // dfa state after each directory path, computed the first time a name of the directory is a candidate
+    const int UNKNOWN = -1;
+    std::vector<int> dirState(blob.dirCount(), UNKNOWN);
+    size_t resets = regex.cacheResets();
+    size_t nextHit = 0;
+    for (size_t entry = 0; entry < blob.entries.size(); entry++) {
+        const NameEntry &each = blob.entries[entry];
+        bool candidate = dirHit[each.dir];
+        while (nextHit < nameHits.size() && nameHits[nextHit] < entry) {
+            nextHit++;
+        }
+        if (nextHit < nameHits.size() && nameHits[nextHit] == entry) {
+            candidate = true;
+        }
+        if (!candidate || !inScope[each.dir]) {
+            continue;
+        }
+        stats.candidates++;
+        if (regex.cacheResets() != resets) {
+            std::fill(dirState.begin(), dirState.end(), UNKNOWN);
+            resets = regex.cacheResets();
+        }
+        if (dirState[each.dir] == UNKNOWN) {
+            dirState[each.dir] = regex.run(regex.start(), blob.dirs.data() + blob.dirOffsets[each.dir],
+                                           blob.dirOffsets[each.dir + 1] - blob.dirOffsets[each.dir]);
+        }
+        if (regex.accepts(regex.run(dirState[each.dir], blob.names.data() + each.offset, each.length))) {
+            matches.push_back(static_cast<uint32_t>(entry));
+        }
+    }
+    return matches;
+}
+
+// ---- baseline for --bench: the full path of every entry through the dfa ----
+inline std::vector<uint32_t> regexEveryPath(Regex &regex, const NameBlob &blob, const std::string &searchDir) {
+    std::vector<uint32_t> matches;
+    for (size_t entry = 0; entry < blob.entries.size(); entry++) {
+        std::string path = blob.path(entry);
+        if (path.compare(0, searchDir.size(), searchDir) == 0 && regex.search(path.data(), path.size())) {
+            matches.push_back(static_cast<uint32_t>(entry));
+        }
+    }
+    return matches;
+}
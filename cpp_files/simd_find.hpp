@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// vectorized memmem shared by the name scans and the content search
+// the kernel compares the first and last character of the needle 16 (sse2) or 32 (avx2) positions at a time
+// and only runs memcmp where both match
+
+inline int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return static_cast<int>(bit);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// first occurrence of needle in haystack[0, length), nullptr if there is none
+inline const char *simdFind(const char *haystack, size_t length, const std::string &needle) {
+    size_t k = needle.size();
+    if (k == 0) {
+        return haystack;
+    }
+    if (length < k) {
+        return nullptr;
+    }
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    for (; i + k - 1 + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + k - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        while (mask) {
+            int bit = lowestBit(mask);
+            if (memcmp(haystack + i + bit, needle.data(), k) == 0) {
+                return haystack + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    for (; i + k - 1 + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + k - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        while (mask) {
+            int bit = lowestBit(mask);
+            if (memcmp(haystack + i + bit, needle.data(), k) == 0) {
+                return haystack + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // what is left after the last full vector, or everything without simd
+    for (; i + k <= length; i++) {
+        if (haystack[i] == needle[0] && memcmp(haystack + i, needle.data(), k) == 0) {
+            return haystack + i;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../libraries/rapidjson/filereadstream.h"
+#include "../libraries/rapidjson/reader.h"
+#include "index_format.hpp"
+
+// result of searching one index file
+enum SearchStatus { SEARCH_OK, SEARCH_NOT_FOUND, SEARCH_FAILED };
+
+// number of index objects looked at by the searches, printed with --stats
+inline std::atomic<uint64_t> nodesVisited(0);
+
+// streaming searcher: walks the index with the rapidjson SAX reader instead of building a DOM,
+// so memory use only depends on how deep the tree is and not on the size of the index file
+class StreamSearch : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, StreamSearch> {
+   public:
+    // atScope: the stream starts at the object of the searched directory instead of the root of the index
+    StreamSearch(const std::string &searchDir, const std::string &userSearch, std::ostream &out, bool atScope = false)
+        : userSearch(userSearch), out(out) {
+        if (atScope) {
+            path = searchDir;
+            return;
+        }
+        // split the search directory into the keys used by the index --> "C:/Users/" = {"C:/", "Users/"}
+        size_t oldFind = 0;
+        size_t newFind = searchDir.find('/', oldFind + 1);
+        while (newFind != std::string::npos) {
+            scopeKeys.push_back(searchDir.substr(oldFind, newFind - oldFind + 1));
+            oldFind = newFind + 1;
+            newFind = searchDir.find('/', oldFind);
+        }
+    }
+
+    // true once the reader entered the object of the searched directory
+    bool scopeFound() const { return scopeEntered; }
+
+    bool StartObject() {
+        if (skipDepth > 0) {
+            skipDepth++;
+            return true;
+        }
+        // a subtree that cannot match the scope or the search term is read but never looked at
+        if (!frames.empty() && (pending == Frame::SKIP || pending == Frame::END || pending == Frame::BLOOM)) {
+            skipDepth = 1;
+            return true;
+        }
+        Frame frame;
+        frame.pathLen = path.size();
+        if (frames.empty()) {
+            // root object of the index, nothing matched yet
+            frame.kind = scopeKeys.empty() ? Frame::DIR : Frame::SCOPE;
+            scopeEntered = scopeKeys.empty();
+        } else {
+            frame.kind = pending;
+            frame.scopeLevel = frames.back().scopeLevel + (pending == Frame::SCOPE ? 1 : 0);
+            path += pendingKey;
+            if (pending == Frame::DIR && !scopeEntered) {
+                scopeEntered = true;
+                frame.scopeRoot = true;
+            }
+        }
+        frames.push_back(frame);
+        nodesVisited++;
+        return true;
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool) {
+        if (skipDepth > 0) {
+            return true;
+        }
+        const Frame &frame = frames.back();
+        pendingKey.assign(str, length);
+
+        // the bloom filter of this directory ruled out the search term, the rest of it is skipped
+        if (frame.pruned) {
+            pending = Frame::SKIP;
+            return true;
+        }
+
+        // above the search directory only follow the keys of the searched path
+        if (frame.kind == Frame::SCOPE) {
+            if (pendingKey != scopeKeys[frame.scopeLevel]) {
+                pending = Frame::SKIP;
+                return true;
+            }
+            pending = frame.scopeLevel + 1 == scopeKeys.size() ? Frame::DIR : Frame::SCOPE;
+            return true;
+        }
+
+        if (pendingKey == BLOOM_KEY) {
+            pending = Frame::BLOOM;
+            return true;
+        }
+
+        // directories are always traversed, an empty key is not one
+        if (!pendingKey.empty() && pendingKey.back() == '/') {
+            pending = Frame::DIR;
+            return true;
+        }
+
+        // "END" key is only printed once enough characters of the name have matched
+        size_t nameLen = path.size() - path.find_last_of('/') - 1;
+        if (pendingKey == "END") {
+            pending = userSearch.length() <= nameLen ? Frame::END : Frame::SKIP;
+            return true;
+        }
+
+        // compare the prefix for a match, anything that does not match is skipped unread
+        size_t minLength = std::min(nameLen + pendingKey.length(), userSearch.length());
+        std::string lastComponent = path.substr(path.size() - nameLen) + pendingKey;
+        pending = userSearch.compare(0, minLength, lastComponent, 0, minLength) == 0 ? Frame::TRIE : Frame::SKIP;
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+        bool leavingScope = frames.back().scopeRoot;
+        path.resize(frames.back().pathLen);
+        frames.pop_back();
+        // everything below the search directory has been seen, stop reading the file
+        return !leavingScope;
+    }
+
+    bool StartArray() {
+        if (skipDepth > 0 || pending != Frame::END) {
+            skipDepth++;
+            return true;
+        }
+        inEnd = true;
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+        inEnd = false;
+        return true;
+    }
+
+    bool String(const char *str, rapidjson::SizeType length, bool) {
+        if (skipDepth == 0 && !inEnd && pending == Frame::BLOOM) {
+            frames.back().pruned = !bloomMayContain(str, length, userSearch);
+            return true;
+        }
+        if (skipDepth == 0 && inEnd) {
+            out << path.substr(0, path.find_last_of('/') + 1);
+            out.write(str, length);
+            out << '\n';
+            out.flush();
+        }
+        return true;
+    }
+
+    // any other value (numbers, bools, null) is not part of the index layout
+    bool Default() { return true; }
+
+   private:
+    struct Frame {
+        enum Kind { SCOPE, DIR, TRIE, END, BLOOM, SKIP };
+        Kind kind = DIR;
+        size_t pathLen = 0;
+        size_t scopeLevel = 0;
+        bool scopeRoot = false;
+        bool pruned = false;
+    };
+
+    const std::string &userSearch;
+    std::ostream &out;
+    std::vector<std::string> scopeKeys;
+
+    // open objects from the root to the current position and the path they represent
+    std::vector<Frame> frames;
+    std::string path;
+    std::string pendingKey;
+    Frame::Kind pending = Frame::SKIP;
+    // number of nested objects/arrays still open in a subtree that cannot match
+    size_t skipDepth = 0;
+    bool inEnd = false;
+    bool scopeEntered = false;
+};
+
+// stream the index file at "file" and print every match to "out" as it is found
+inline SearchStatus streamSearch(const std::string &file, const std::string &searchDir, const std::string &userSearch, std::ostream &out) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        std::cerr << "Failed to open JSON file" << ' ' + file << std::endl;
+        return SEARCH_FAILED;
+    }
+
+    // with a directory offset table only the bytes of the searched directory are read
+    DirOffset scope;
+    std::error_code ec;
+    uint64_t filesize = std::filesystem::file_size(file, ec);
+    bool seeked = !ec && findDirOffset(offsetTablePath(file), filesize, searchDir, scope) && seekFile(fp, scope.offset) == 0;
+
+    StreamSearch handler(searchDir, userSearch, out, seeked);
+    char readBuffer[1 << 16];
+    rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse<rapidjson::kParseIterativeFlag | rapidjson::kParseStopWhenDoneFlag>(is, handler);
+    fclose(fp);
+
+    // termination means the handler stopped after leaving the searched directory
+    if (!result && result.Code() != rapidjson::kParseErrorTermination) {
+        std::cerr << "Failed to load JSON file at offset " << result.Offset() << std::endl;
+        return SEARCH_FAILED;
+    }
+    return handler.scopeFound() ? SEARCH_OK : SEARCH_NOT_FOUND;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "index_format.hpp"
+
+// the names of a shard spelled backwards and sorted, next to the file index as .suffix
+// a name ending in "_test" starts with "tset_" backwards, so the names with a suffix are one range of the sorted
+// array found with two binary searches, the same cost as a prefix in the trie
+// names are lowercase, like the rest of the index
+// file layout: magic, name count, name bytes, then the name offsets (u32, count + 1), the name blob entry of each
+// name (u32) and the reversed names, all in sorted order
+
+const char SUFFIX_MAGIC[8] = {'F', 'F', 'S', 'U', 'F', 'F', 'X', '1'};
+
+inline bool writeSuffixIndex(const std::string &file, const NameBlob &blob) {
+    std::vector<std::pair<std::string, uint32_t>> reversed;
+    reversed.reserve(blob.entries.size());
+    for (size_t i = 0; i < blob.entries.size(); i++) {
+        const NameEntry &entry = blob.entries[i];
+        std::string name = blob.lower.substr(entry.offset, entry.length);
+        std::reverse(name.begin(), name.end());
+        reversed.push_back({std::move(name), static_cast<uint32_t>(i)});
+    }
+    std::sort(reversed.begin(), reversed.end());
+
+    std::vector<uint32_t> offsets = {0}, entries;
+    std::string text;
+    for (const auto &[name, entry] : reversed) {
+        text += name;
+        offsets.push_back(static_cast<uint32_t>(text.size()));
+        entries.push_back(entry);
+    }
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    uint64_t header[2] = {reversed.size(), text.size()};
+    bool ok = fwrite(SUFFIX_MAGIC, 1, sizeof(SUFFIX_MAGIC), fp) == sizeof(SUFFIX_MAGIC) && fwrite(header, sizeof(header), 1, fp) == 1 &&
+              fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), fp) == offsets.size() &&
+              fwrite(entries.data(), sizeof(uint32_t), entries.size(), fp) == entries.size() &&
+              fwrite(text.data(), 1, text.size(), fp) == text.size();
+    return fclose(fp) == 0 && ok;
+}
+
+// read-only view of a .suffix file, usually a memory mapping
+class SuffixIndex {
+   public:
+    bool open(const char *file, size_t fileSize) {
+        uint64_t header[2];
+        if (fileSize < sizeof(SUFFIX_MAGIC) + sizeof(header) || memcmp(file, SUFFIX_MAGIC, sizeof(SUFFIX_MAGIC)) != 0) {
+            return false;
+        }
+        memcpy(header, file + sizeof(SUFFIX_MAGIC), sizeof(header));
+        count = header[0];
+        offsets = reinterpret_cast<const uint32_t *>(file + sizeof(SUFFIX_MAGIC) + sizeof(header));
+        entries = offsets + count + 1;
+        text = reinterpret_cast<const char *>(entries + count);
+        return text + header[1] == file + fileSize;
+    }
+
+    size_t size() const { return count; }
+
+    // the name blob entries whose lowercase name ends with suffix, as [begin, end)
+    std::pair<const uint32_t *, const uint32_t *> endingWith(const std::string &suffix) const {
+        std::string key = suffix;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        std::reverse(key.begin(), key.end());
+        // first name not less than the key, then the first one that does not start with it
+        size_t low = 0, high = count;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (compare(mid, key, false) < 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        size_t first = low;
+        high = count;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (compare(mid, key, true) <= 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return {entries + first, entries + low};
+    }
+
+   private:
+    // order of name id against key, with prefixOnly a name starting with the key counts as equal
+    int compare(size_t id, const std::string &key, bool prefixOnly) const {
+        size_t length = offsets[id + 1] - offsets[id];
+        int order = memcmp(text + offsets[id], key.data(), std::min(length, key.size()));
+        if (order != 0) {
+            return order;
+        }
+        if (length >= key.size()) {
+            return prefixOnly || length == key.size() ? 0 : 1;
+        }
+        return -1;
+    }
+
+    uint64_t count = 0;
+    const uint32_t *offsets = nullptr;
+    const uint32_t *entries = nullptr;
+    const char *text = nullptr;
+};